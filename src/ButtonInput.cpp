@@ -0,0 +1,111 @@
+#include "ButtonInput.h"
+
+#include <atomic>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+using namespace ace_button;
+
+namespace
+{
+    struct Edge
+    {
+        uint32_t time; // ms, clock for AceButton
+        uint32_t timeMicros; // us, for latency
+        uint8_t level;
+    };
+
+    constexpr uint8_t queueSize = 32; // Power of two
+    // Single producer (interrupt), single consumer (check). Each side publishes its index with release after it is
+    // done with the entry, and reads the index of the other side with acquire before it touches an entry.
+    Edge queue[queueSize];
+    std::atomic<uint8_t> queueHead {0};
+    std::atomic<uint8_t> queueTail {0};
+    volatile uint32_t numDropped = 0;
+    uint8_t interruptPin = 0;
+
+    void IRAM_ATTR handleEdge()
+    {
+        const uint8_t head = queueHead.load(std::memory_order_relaxed);
+        if ((uint8_t)(head - queueTail.load(std::memory_order_acquire)) == queueSize)
+        {
+            ++numDropped;
+            return;
+        }
+        Edge& edge = queue[head % queueSize];
+        edge.time = millis();
+        edge.timeMicros = micros();
+        edge.level = digitalRead(interruptPin);
+        queueHead.store(head + 1, std::memory_order_release);
+    }
+} // namespace
+
+void ButtonInput::begin(uint8_t pin)
+{
+    interruptPin = pin;
+    level = digitalRead(pin);
+    clock = millis();
+    attachInterrupt(digitalPinToInterrupt(pin), handleEdge, CHANGE);
+}
+
+void ButtonInput::check(AceButton& button)
+{
+    uint8_t tail = queueTail.load(std::memory_order_relaxed);
+    while (tail != queueHead.load(std::memory_order_acquire))
+    {
+        const Edge edge = queue[tail % queueSize];
+        ++tail;
+        queueTail.store(tail, std::memory_order_release);
+
+        advanceTo(button, edge.time);
+        if (edge.level == LOW && level == HIGH)
+        {
+            pressTime = edge.timeMicros;
+        }
+        level = edge.level;
+        button.check();
+    }
+    advanceTo(button, millis());
+    button.check();
+}
+
+void ButtonInput::eventHandled(uint8_t eventType)
+{
+    if (eventType == AceButton::kEventPressed)
+    {
+        lastLatency = micros() - pressTime;
+        if (lastLatency > maxLatency)
+        {
+            maxLatency = lastLatency;
+        }
+    }
+}
+
+void ButtonInput::getStatusJsonString(JsonObject& output)
+{
+    auto&& button = output.createNestedObject("button");
+    button["press_latency_us"] = lastLatency;
+    button["max_press_latency_us"] = maxLatency;
+    button["dropped_edges"] = numDropped;
+}
+
+void ButtonInput::advanceTo(AceButton& button, unsigned long time)
+{
+    // Edges captured while the queue was read can be slightly older than the clock
+    if ((long)(time - clock) <= 0)
+    {
+        return;
+    }
+    if (time - clock > maxCatchUp)
+    {
+        clock = time - maxCatchUp;
+    }
+    while (time - clock > maxStep)
+    {
+        clock += maxStep;
+        button.check();
+    }
+    clock = time;
+}
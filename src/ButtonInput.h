@@ -0,0 +1,47 @@
+#pragma once
+
+#include <AceButton.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "Constants.h"
+
+///@brief Button config which replays edges captured in an interrupt to AceButton
+///
+/// The interrupt stores the time and level of every edge in a lock-free queue. @ref check feeds them to AceButton
+/// with their capture time as clock, so debouncing and click detection do not depend on how often the loop runs.
+/// After a stall the clock is advanced in small steps, so repeated long press events are not lost.
+class ButtonInput : public ace_button::ButtonConfig
+{
+public:
+    ///@brief Start capturing edges of the pin, only one instance can be active
+    void begin(uint8_t pin);
+
+    ///@brief Replay the captured edges and check for time based events
+    void check(ace_button::AceButton& button);
+
+    ///@brief Has to be called by the event handler, to measure the reaction time
+    void eventHandled(uint8_t eventType);
+
+    unsigned long getClock() override { return clock; }
+    int readButton(uint8_t) override { return level; }
+
+    void getStatusJsonString(JsonObject& output);
+
+private:
+    ///@brief Run checks until the clock reaches time
+    void advanceTo(ace_button::AceButton& button, unsigned long time);
+
+private:
+    static constexpr unsigned long maxStep = 10; // ms between checks when catching up
+    static constexpr unsigned long maxCatchUp = 10000; // ms, longer stalls are skipped
+
+    unsigned long clock = 0;
+    int level = HIGH;
+    uint32_t pressTime = 0; // us of the first edge of the last press
+    uint32_t lastLatency = 0; // us from press to handled event
+    uint32_t maxLatency = 0;
+};
+
+/// Button input of the tree
+extern ButtonInput buttonInput;
@@ -0,0 +1,134 @@
+#include "CaptiveDns.h"
+
+namespace
+{
+    constexpr uint16_t typeA = 1;
+    constexpr uint16_t typeAny = 255;
+    constexpr uint16_t classIn = 1;
+
+    uint16_t readBe16(const uint8_t* p)
+    {
+        return ((uint16_t)p[0] << 8) | p[1];
+    }
+} // namespace
+
+bool CaptiveDns::start(const IPAddress& ip, uint16_t port)
+{
+    stop();
+    const uint8_t record[answerSize] = {0xC0, headerSize, // Pointer to the name in the question
+        0, typeA, 0, classIn, (uint8_t)(ttl >> 24), (uint8_t)(ttl >> 16), (uint8_t)(ttl >> 8), (uint8_t)ttl, 0, 4,
+        ip[0], ip[1], ip[2], ip[3]};
+    memcpy(answerRecord, record, sizeof(answerRecord));
+    running = udp.begin(port) == 1;
+    lastPoll = micros();
+    return running;
+}
+
+void CaptiveDns::stop()
+{
+    if (running)
+    {
+        udp.stop();
+        running = false;
+    }
+}
+
+void CaptiveDns::process()
+{
+    if (!running)
+    {
+        return;
+    }
+    const uint32_t now = micros();
+    const uint32_t interval = now - lastPoll;
+    lastPoll = now;
+    if (interval > maxPollInterval)
+    {
+        maxPollInterval = interval;
+    }
+
+    for (uint8_t i = 0; i < maxQueriesPerPass; ++i)
+    {
+        const int size = udp.parsePacket();
+        if (size <= 0)
+        {
+            break;
+        }
+        const uint32_t start = micros();
+        // The rest of a packet which is too large is dropped by the next parsePacket
+        const size_t len = udp.read(packet, sizeof(packet));
+        if ((size_t)size > sizeof(packet) || !answer(len))
+        {
+            ++numIgnored;
+            continue;
+        }
+        const uint32_t duration = micros() - start;
+        ++numAnswered;
+        totalMicros += duration;
+        if (duration > maxMicros)
+        {
+            maxMicros = duration;
+        }
+    }
+}
+
+void CaptiveDns::getStatusJsonString(JsonObject& output)
+{
+    auto&& dns = output.createNestedObject("dns");
+    dns["running"] = running;
+    dns["answered"] = numAnswered;
+    dns["ignored"] = numIgnored;
+    dns["avg_us"] = numAnswered ? totalMicros / numAnswered : 0;
+    dns["max_us"] = maxMicros;
+    dns["max_poll_interval_us"] = maxPollInterval;
+}
+
+bool CaptiveDns::answer(size_t len)
+{
+    if (len < headerSize)
+    {
+        return false;
+    }
+    // Standard query (QR and opcode 0) with exactly one question and no answers
+    if ((packet[2] & 0xF8) != 0 || readBe16(packet + 4) != 1 || readBe16(packet + 6) != 0
+        || readBe16(packet + 8) != 0)
+    {
+        return false;
+    }
+    // Skip the name labels, compression is not used in questions
+    size_t pos = headerSize;
+    while (pos < len && packet[pos] != 0)
+    {
+        if (packet[pos] & 0xC0)
+        {
+            return false;
+        }
+        pos += packet[pos] + 1;
+    }
+    // Zero length label, type and class
+    pos += 5;
+    if (pos > len)
+    {
+        return false;
+    }
+    const uint16_t type = readBe16(packet + pos - 4);
+    const uint16_t qclass = readBe16(packet + pos - 2);
+    // Other types get an empty NoError answer, like DNSServer with DNSReplyCode::NoError
+    const bool hasAnswer = (type == typeA || type == typeAny) && qclass == classIn;
+
+    // Response, authoritative, keep recursion desired, recursion not available, no error
+    packet[2] = 0x84 | (packet[2] & 0x01);
+    packet[3] = 0;
+    packet[6] = 0;
+    packet[7] = hasAnswer ? 1 : 0;
+    // Additional records (EDNS) of the query are dropped
+    memset(packet + 8, 0, 4);
+
+    udp.beginPacket(udp.remoteIP(), udp.remotePort());
+    udp.write(packet, pos);
+    if (hasAnswer)
+    {
+        udp.write(answerRecord, sizeof(answerRecord));
+    }
+    return udp.endPacket() == 1;
+}
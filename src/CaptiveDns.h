@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFiUdp.h>
+
+#include "Constants.h"
+
+///@brief Minimal DNS server for the captive portal, answers every A query with the access point ip
+///
+/// Replaces DNSServer, which answered one query per call and was only polled once every second.
+/// @ref process is meant to be called every loop pass and answers from a precomputed answer record,
+/// so a query is answered within one loop pass instead of up to a second.
+class CaptiveDns
+{
+public:
+    ///@brief Start answering queries
+    ///@param ip Address to return for all names
+    bool start(const IPAddress& ip, uint16_t port = 53);
+    void stop();
+
+    ///@brief Answer pending queries, a limited number per call
+    void process();
+
+    void getStatusJsonString(JsonObject& output);
+
+private:
+    ///@brief Answer the query in @ref packet
+    ///@returns false if it is not a valid query
+    bool answer(size_t len);
+
+private:
+    static constexpr size_t headerSize = 12;
+    static constexpr size_t answerSize = 16;
+    static constexpr uint8_t maxQueriesPerPass = 4;
+    static constexpr uint32_t ttl = 60; // s
+
+    WiFiUDP udp;
+    bool running = false;
+    // Name pointer to the question, type A, class IN, ttl, length 4 and the ip
+    uint8_t answerRecord[answerSize] = {};
+    uint8_t packet[512];
+    uint32_t numAnswered = 0;
+    uint32_t numIgnored = 0;
+    uint32_t totalMicros = 0; // Time spent answering
+    uint32_t maxMicros = 0;
+    uint32_t maxPollInterval = 0; // us, upper bound for the time a query waits
+    uint32_t lastPoll = 0;
+};
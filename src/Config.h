@@ -5,72 +5,8 @@
 #include <ESPAsyncWebServer.h>
 #include <FS.h>
 
+#include "ConfigFields.h"
 #include "Constants.h"
-#include "TreeEffects.h"
-
-struct NetworkConfig
-{
-    bool clientEnabled = false;
-    String clientSsid = "YourWifi";
-    String clientPassword = "inputyourown";
-    bool dhcpEnabled = true;
-    IPAddress clientMask;
-    IPAddress clientGateway;
-    IPAddress clientDns;
-    IPAddress clientIp;
-    bool apEnabled = true;
-    String apSsid;
-    String apPassword;
-    bool wifiEnabled = false;
-
-    /// @brief Verify that the object can be parsed
-    /// @returns true if fromJson can be executed
-    bool verify(const JsonObjectConst& object) const;
-    void fromJson(const JsonObjectConst& object);
-    void toJson(JsonObject& object) const;
-
-    /// @brief Update all fields in object, if possible
-    /// @returns true when any value was changed
-    bool tryUpdate(const JsonObjectConst& object);
-};
-
-struct MqttConfig
-{
-    bool enabled = false;
-    String server;
-    unsigned int port = 1883;
-    String id = "LedChristmasTree";
-    String user;
-    String password;
-
-    /// @brief Verify that the object can be parsed
-    /// @returns true if fromJson can be executed
-    bool verify(const JsonObjectConst& object) const;
-    void fromJson(const JsonObjectConst& object);
-    void toJson(JsonObject& object) const;
-
-    /// @brief Update all fields in object, if possible
-    /// @returns true when any value was changed
-    bool tryUpdate(const JsonObjectConst& object);
-};
-
-struct EffectConfig
-{
-    uint8_t speed = 2;
-    uint8_t brightnessLevel = 4;
-    EffectType currentEffectType = EffectType::off;
-    uint8_t colorSelection = 0;
-
-    /// @brief Verify that the object can be parsed
-    /// @returns true if fromJson can be executed
-    bool verify(const JsonObjectConst& object) const;
-    void fromJson(const JsonObjectConst& object);
-    void toJson(JsonObject& object) const;
-
-    /// @brief Update all fields in object, if possible
-    /// @returns true when any value was changed
-    bool tryUpdate(const JsonObjectConst& object);
-};
 
 class Config
 {
@@ -78,10 +14,18 @@ public:
     void initConfig();
     NetworkConfig& getNetworkConfig();
     MqttConfig& getMqttConfig();
+    LedConfig& getLedConfig();
     EffectConfig& getEffectConfig();
     void setDefaultConfig();
     void saveConfig();
-    void createJson(JsonDocument& output);
+
+    /// @brief Write wifi, mqtt and led config as json
+    /// @param redact Replace passwords by a bool whether they are set
+    void writeJson(Print& output, bool redact);
+
+    /// @brief Update wifi, mqtt and led config from the "wifi", "mqtt" and "leds" members of data, if possible
+    /// @returns true when any value was changed
+    bool tryUpdate(const JsonObjectConst& data);
 
     void saveEffect();
 
@@ -92,5 +36,6 @@ private:
 private:
     NetworkConfig networkConfig;
     MqttConfig mqttConfig;
+    LedConfig ledConfig;
     EffectConfig effectConfig;
 }; // namespace Networking
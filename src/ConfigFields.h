@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ConfigSchema.h"
+#include "OutputLut.h"
+#include "Segment.h"
+#include "TreeEffects.h"
+
+// Config structs and their field tables, without the file system and the web server of Config.h
+
+/// Maximum length of a wifi ssid, without terminator
+constexpr size_t ssidLength = 32;
+/// Maximum length of a wifi or mqtt password, without terminator
+constexpr size_t passwordLength = 64;
+/// Maximum length of the LED calibration, 6 hex digits for each of up to 16 LEDs, without terminator
+constexpr size_t calibrationLength = 16 * 6;
+
+struct NetworkConfig
+{
+    bool clientEnabled = false;
+    char clientSsid[ssidLength + 1] = "YourWifi";
+    char clientPassword[passwordLength + 1] = "inputyourown";
+    bool dhcpEnabled = true;
+    uint32_t clientMask = 0; ///< IPv4 address in IPAddress byte order
+    uint32_t clientGateway = 0; ///< IPv4 address in IPAddress byte order
+    uint32_t clientDns = 0; ///< IPv4 address in IPAddress byte order
+    uint32_t clientIp = 0; ///< IPv4 address in IPAddress byte order
+    bool apEnabled = true;
+    char apSsid[ssidLength + 1] = "";
+    char apPassword[passwordLength + 1] = "";
+    bool wifiEnabled = false;
+};
+
+struct MqttConfig
+{
+    bool enabled = false;
+    char server[64] = "";
+    uint16_t port = 1883;
+    char id[33] = "LedChristmasTree";
+    char user[33] = "";
+    char password[passwordLength + 1] = "";
+};
+
+struct LedConfig
+{
+    uint16_t maxCurrent = 500; ///< Current budget of the supply in mA, 0 for no limit
+    bool dithering = OutputLut::ditheringDefault; ///< Temporal dithering for smooth fades at low brightness
+    uint8_t transition = 0; ///< TransitionType when the effect changes
+    char calibration[calibrationLength + 1] = ""; ///< RRGGBB output scale per LED in chain order, see TreeLight
+};
+
+struct EffectConfig
+{
+    uint8_t speed = 2;
+    uint8_t brightnessLevel = 4;
+    EffectType currentEffectType = EffectType::off;
+    uint8_t colorSelection = 0;
+    SegmentConfig segments[TreeEffects::maxSegments];
+};
+
+inline constexpr FieldDescriptor networkFields[] = {
+    CONFIG_FIELD(NetworkConfig, clientEnabled, "client_enabled", FieldType::boolean),
+    CONFIG_FIELD(NetworkConfig, dhcpEnabled, "client_dhcp_enabled", FieldType::boolean),
+    CONFIG_FIELD(NetworkConfig, clientSsid, "client_ssid", FieldType::string),
+    CONFIG_FIELD_SECRET(NetworkConfig, clientPassword, "client_password", "client_has_password"),
+    CONFIG_FIELD_OPTIONAL(NetworkConfig, clientIp, "client_ip", FieldType::ip),
+    CONFIG_FIELD(NetworkConfig, clientGateway, "client_gateway", FieldType::ip),
+    CONFIG_FIELD(NetworkConfig, clientDns, "client_dns", FieldType::ip),
+    CONFIG_FIELD(NetworkConfig, clientMask, "client_mask", FieldType::ip),
+    CONFIG_FIELD(NetworkConfig, apEnabled, "ap_enabled", FieldType::boolean),
+    CONFIG_FIELD(NetworkConfig, apSsid, "ap_ssid", FieldType::string),
+    CONFIG_FIELD_SECRET(NetworkConfig, apPassword, "ap_password", "ap_has_password"),
+    CONFIG_FIELD(NetworkConfig, wifiEnabled, "wifi_enabled", FieldType::boolean),
+};
+
+inline constexpr FieldDescriptor mqttFields[] = {
+    CONFIG_FIELD(MqttConfig, enabled, "enabled", FieldType::boolean),
+    CONFIG_FIELD(MqttConfig, server, "server", FieldType::string),
+    CONFIG_FIELD(MqttConfig, port, "port", FieldType::uint16),
+    CONFIG_FIELD(MqttConfig, id, "id", FieldType::string),
+    CONFIG_FIELD(MqttConfig, user, "user", FieldType::string),
+    CONFIG_FIELD_SECRET(MqttConfig, password, "password", "has_password"),
+};
+
+// Added later, so existing files are still complete
+inline constexpr FieldDescriptor ledFields[] = {
+    CONFIG_FIELD_OPTIONAL(LedConfig, maxCurrent, "max_current", FieldType::uint16),
+    CONFIG_FIELD_OPTIONAL(LedConfig, dithering, "dithering", FieldType::boolean),
+    CONFIG_FIELD_OPTIONAL(LedConfig, transition, "transition", FieldType::uint8),
+    CONFIG_FIELD_OPTIONAL(LedConfig, calibration, "calibration", FieldType::string),
+};
+
+static_assert(sizeof(EffectType) == 1, "EffectType is stored as uint8");
+inline constexpr FieldDescriptor effectFields[] = {
+    CONFIG_FIELD(EffectConfig, speed, "speed", FieldType::uint8),
+    CONFIG_FIELD(EffectConfig, brightnessLevel, "brightness", FieldType::uint8),
+    CONFIG_FIELD(EffectConfig, currentEffectType, "effect", FieldType::uint8),
+    CONFIG_FIELD(EffectConfig, colorSelection, "color", FieldType::uint8),
+};
+
+// Added later, so existing files are still complete
+inline constexpr FieldDescriptor segmentFields[] = {
+    CONFIG_FIELD_OPTIONAL(SegmentConfig, enabled, "enabled", FieldType::boolean),
+    CONFIG_FIELD_OPTIONAL(SegmentConfig, start, "start", FieldType::uint8),
+    CONFIG_FIELD_OPTIONAL(SegmentConfig, end, "end", FieldType::uint8),
+    CONFIG_FIELD_OPTIONAL(SegmentConfig, effect, "effect", FieldType::uint8),
+    CONFIG_FIELD_OPTIONAL(SegmentConfig, colorSelection, "color", FieldType::uint8),
+    CONFIG_FIELD_OPTIONAL(SegmentConfig, speed, "speed", FieldType::uint8),
+};
@@ -0,0 +1,639 @@
+#include "ConfigSchema.h"
+
+#include <limits.h>
+#include <string.h>
+
+namespace
+{
+    /// Longest key that can match a field, longer keys are skipped
+    constexpr size_t keySize = 32;
+    /// Longer than the largest string field, so that too long values can be detected
+    constexpr size_t valueSize = 96;
+
+    /// @brief Scalar json value, either read from a stream or converted from a JsonVariant
+    struct Value
+    {
+        enum class Kind : uint8_t
+        {
+            other, // null, float, object or array, never valid for a field
+            boolean,
+            number,
+            string
+        };
+        Kind kind = Kind::other;
+        bool boolean = false;
+        long number = 0;
+        const char* str = "";
+        bool truncated = false; // String did not fit in the buffer
+    };
+
+    template <typename T>
+    bool store(uint8_t* dst, T value)
+    {
+        T old;
+        memcpy(&old, dst, sizeof(T));
+        if (old == value)
+        {
+            return false;
+        }
+        memcpy(dst, &value, sizeof(T));
+        return true;
+    }
+
+    /// @brief Apply value to the field, if it has the right type and range
+    /// @param changed Set to true if the stored value was changed
+    /// @returns true if the value was valid for the field
+    bool applyValue(const FieldDescriptor& field, uint8_t* object, const Value& value, bool& changed)
+    {
+        uint8_t* dst = object + field.offset;
+        switch (field.type)
+        {
+        case FieldType::boolean:
+            if (value.kind != Value::Kind::boolean)
+            {
+                return false;
+            }
+            changed |= store<bool>(dst, value.boolean);
+            return true;
+        case FieldType::uint8:
+            if (value.kind != Value::Kind::number || value.number < 0 || value.number > UINT8_MAX)
+            {
+                return false;
+            }
+            changed |= store<uint8_t>(dst, (uint8_t)value.number);
+            return true;
+        case FieldType::uint16:
+            if (value.kind != Value::Kind::number || value.number < 0 || value.number > UINT16_MAX)
+            {
+                return false;
+            }
+            changed |= store<uint16_t>(dst, (uint16_t)value.number);
+            return true;
+        case FieldType::ip: {
+            IPAddress ip;
+            if (value.kind != Value::Kind::string || value.truncated || !ip.fromString(value.str))
+            {
+                return false;
+            }
+            changed |= store<uint32_t>(dst, (uint32_t)ip);
+            return true;
+        }
+        case FieldType::string: {
+            if (value.kind != Value::Kind::string || value.truncated)
+            {
+                return false;
+            }
+            const size_t len = strlen(value.str);
+            if (len >= field.size)
+            {
+                return false;
+            }
+            char* str = reinterpret_cast<char*>(dst);
+            if (strcmp(str, value.str) != 0)
+            {
+                memcpy(str, value.str, len + 1);
+                changed = true;
+            }
+            return true;
+        }
+        }
+        return false;
+    }
+
+    int findField(const ConfigSection& section, const char* name)
+    {
+        for (uint8_t i = 0; i < section.numFields; ++i)
+        {
+            if (strcmp(section.fields[i].name, name) == 0)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool sameKey(const char* a, const char* b)
+    {
+        return a == b || (a != nullptr && b != nullptr && strcmp(a, b) == 0);
+    }
+
+    /// @brief Minimal pull parser for json, reading one character at a time
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(Stream& in) : in(in) { }
+
+        /// @brief Peek at the next character after whitespace
+        int peek()
+        {
+            int c = in.peek();
+            while (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+            {
+                in.read();
+                c = in.peek();
+            }
+            return c;
+        }
+
+        /// @brief Consume c if it is the next character after whitespace
+        bool consume(char c)
+        {
+            if (peek() == c)
+            {
+                in.read();
+                return true;
+            }
+            return false;
+        }
+
+        /// @brief Read a string into buffer, which is always null terminated
+        /// @param truncated Set to true if the string did not fit
+        bool readString(char* buffer, size_t size, bool& truncated)
+        {
+            truncated = false;
+            if (!consume('"'))
+            {
+                return false;
+            }
+            size_t len = 0;
+            auto append = [&](char c) {
+                if (len + 1 < size)
+                {
+                    buffer[len++] = c;
+                }
+                else
+                {
+                    truncated = true;
+                }
+            };
+            while (true)
+            {
+                int c = in.read();
+                if (c < 0)
+                {
+                    return false;
+                }
+                else if (c == '"')
+                {
+                    break;
+                }
+                else if (c != '\\')
+                {
+                    append((char)c);
+                    continue;
+                }
+                c = in.read();
+                switch (c)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    append((char)c);
+                    break;
+                case 'b':
+                    append('\b');
+                    break;
+                case 'f':
+                    append('\f');
+                    break;
+                case 'n':
+                    append('\n');
+                    break;
+                case 'r':
+                    append('\r');
+                    break;
+                case 't':
+                    append('\t');
+                    break;
+                case 'u': {
+                    uint16_t codepoint = 0;
+                    for (uint8_t i = 0; i < 4; ++i)
+                    {
+                        c = in.read();
+                        uint8_t digit;
+                        if (c >= '0' && c <= '9')
+                        {
+                            digit = c - '0';
+                        }
+                        else if (c >= 'a' && c <= 'f')
+                        {
+                            digit = c - 'a' + 10;
+                        }
+                        else if (c >= 'A' && c <= 'F')
+                        {
+                            digit = c - 'A' + 10;
+                        }
+                        else
+                        {
+                            return false;
+                        }
+                        codepoint = (codepoint << 4) | digit;
+                    }
+                    // Encode as utf-8, surrogate pairs are not combined
+                    if (codepoint < 0x80)
+                    {
+                        append((char)codepoint);
+                    }
+                    else if (codepoint < 0x800)
+                    {
+                        append((char)(0xC0 | (codepoint >> 6)));
+                        append((char)(0x80 | (codepoint & 0x3F)));
+                    }
+                    else
+                    {
+                        append((char)(0xE0 | (codepoint >> 12)));
+                        append((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+                        append((char)(0x80 | (codepoint & 0x3F)));
+                    }
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            buffer[len] = '\0';
+            return true;
+        }
+
+        /// @brief Read any value, only scalars are stored in value
+        /// @param buffer Storage for string values
+        bool readValue(Value& value, char* buffer, size_t size)
+        {
+            value = Value();
+            const int c = peek();
+            if (c == '"')
+            {
+                value.kind = Value::Kind::string;
+                value.str = buffer;
+                return readString(buffer, size, value.truncated);
+            }
+            else if (c == '{' || c == '[')
+            {
+                return skipContainer();
+            }
+            else if (c == 't')
+            {
+                value.kind = Value::Kind::boolean;
+                value.boolean = true;
+                return readLiteral("true");
+            }
+            else if (c == 'f')
+            {
+                value.kind = Value::Kind::boolean;
+                return readLiteral("false");
+            }
+            else if (c == 'n')
+            {
+                return readLiteral("null");
+            }
+            return readNumber(value);
+        }
+
+        bool skipValue()
+        {
+            Value value;
+            char scratch[1];
+            return readValue(value, scratch, sizeof(scratch));
+        }
+
+    private:
+        bool readLiteral(const char* literal)
+        {
+            for (; *literal; ++literal)
+            {
+                if (in.read() != *literal)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool readNumber(Value& value)
+        {
+            bool negative = false;
+            if (in.peek() == '-')
+            {
+                negative = true;
+                in.read();
+            }
+            bool digits = false;
+            bool integer = true;
+            unsigned long number = 0;
+            while (true)
+            {
+                const int c = in.peek();
+                if (c >= '0' && c <= '9')
+                {
+                    digits = true;
+                    if (number > (unsigned long)LONG_MAX / 10)
+                    {
+                        integer = false; // Too large for any field
+                    }
+                    number = number * 10 + (c - '0');
+                }
+                else if (c == '.' || c == 'e' || c == 'E' || c == '+' || (c == '-' && digits))
+                {
+                    integer = false;
+                }
+                else
+                {
+                    break;
+                }
+                in.read();
+            }
+            if (digits && integer && number <= (unsigned long)LONG_MAX)
+            {
+                value.kind = Value::Kind::number;
+                value.number = negative ? -(long)number : (long)number;
+            }
+            return digits;
+        }
+
+        bool skipContainer()
+        {
+            uint16_t depth = 0;
+            do
+            {
+                const int c = in.read();
+                if (c < 0)
+                {
+                    return false;
+                }
+                else if (c == '"')
+                {
+                    // Skip string contents, so that brackets in strings are ignored
+                    int s = in.read();
+                    while (s != '"')
+                    {
+                        if (s < 0 || (s == '\\' && in.read() < 0))
+                        {
+                            return false;
+                        }
+                        s = in.read();
+                    }
+                }
+                else if (c == '{' || c == '[')
+                {
+                    ++depth;
+                }
+                else if (c == '}' || c == ']')
+                {
+                    --depth;
+                }
+            } while (depth > 0);
+            return true;
+        }
+
+    private:
+        Stream& in;
+    };
+
+    /// @brief Parse an object and apply all members to the sections with sectionKey
+    ///
+    /// In the root object (sectionKey == nullptr) nested objects are matched to the keys of the sections.
+    bool parseObject(JsonReader& reader, ConfigSection* sections, uint8_t numSections, const char* sectionKey)
+    {
+        if (!reader.consume('{'))
+        {
+            return false;
+        }
+        if (reader.consume('}'))
+        {
+            return true;
+        }
+        char key[keySize];
+        char buffer[valueSize];
+        do
+        {
+            bool truncated;
+            if (!reader.readString(key, sizeof(key), truncated) || !reader.consume(':'))
+            {
+                return false;
+            }
+            bool handled = false;
+            for (uint8_t i = 0; i < numSections && !truncated && !handled; ++i)
+            {
+                ConfigSection& s = sections[i];
+                int field;
+                if (sameKey(s.key, sectionKey) && (field = findField(s, key)) >= 0)
+                {
+                    Value value;
+                    if (!reader.readValue(value, buffer, sizeof(buffer)))
+                    {
+                        return false;
+                    }
+                    if (applyValue(s.fields[field], s.object, value, s.changed))
+                    {
+                        s.setFields |= 1ul << field;
+                    }
+                    handled = true;
+                }
+                else if (sectionKey == nullptr && s.key != nullptr && strcmp(s.key, key) == 0 && reader.peek() == '{')
+                {
+                    if (!parseObject(reader, sections, numSections, s.key))
+                    {
+                        return false;
+                    }
+                    handled = true;
+                }
+            }
+            if (!handled && !reader.skipValue())
+            {
+                return false;
+            }
+        } while (reader.consume(','));
+        return reader.consume('}');
+    }
+
+    void writeKey(Print& out, const char* key, bool& first)
+    {
+        if (!first)
+        {
+            out.write(',');
+        }
+        first = false;
+        out.write('"');
+        out.print(key);
+        out.write("\":", 2);
+    }
+
+    void writeString(Print& out, const char* str)
+    {
+        out.write('"');
+        const char* start = str;
+        for (; *str; ++str)
+        {
+            const uint8_t c = *str;
+            if (c != '"' && c != '\\' && c >= 0x20)
+            {
+                continue;
+            }
+            out.write(start, str - start);
+            start = str + 1;
+            if (c == '"' || c == '\\')
+            {
+                out.write('\\');
+                out.write(c);
+            }
+            else
+            {
+                static const char hex[] = "0123456789abcdef";
+                const char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                out.write(escaped, sizeof(escaped));
+            }
+        }
+        out.write(start, str - start);
+        out.write('"');
+    }
+} // namespace
+
+bool ConfigSection::isComplete() const
+{
+    for (uint8_t i = 0; i < numFields; ++i)
+    {
+        if (fields[i].required && !(setFields & (1ul << i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConfigSection::wasSet(const char* name) const
+{
+    const int field = findField(*this, name);
+    return field >= 0 && (setFields & (1ul << field));
+}
+
+bool ConfigSection::tryUpdate(const JsonObjectConst& json)
+{
+    setFields = 0;
+    changed = false;
+    if (json.isNull())
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < numFields; ++i)
+    {
+        JsonVariantConst v = json[fields[i].name];
+        Value value;
+        if (v.is<bool>())
+        {
+            value.kind = Value::Kind::boolean;
+            value.boolean = v.as<bool>();
+        }
+        else if (v.is<long>())
+        {
+            value.kind = Value::Kind::number;
+            value.number = v.as<long>();
+        }
+        else if (v.is<const char*>())
+        {
+            value.kind = Value::Kind::string;
+            value.str = v.as<const char*>();
+        }
+        else
+        {
+            continue;
+        }
+        if (applyValue(fields[i], object, value, changed))
+        {
+            setFields |= 1ul << i;
+        }
+    }
+    return changed;
+}
+
+void ConfigSection::writeFields(Print& out, bool redact) const
+{
+    bool first = true;
+    for (uint8_t i = 0; i < numFields; ++i)
+    {
+        const FieldDescriptor& field = fields[i];
+        const uint8_t* src = object + field.offset;
+        if (redact && field.redactedName != nullptr)
+        {
+            writeKey(out, field.redactedName, first);
+            out.print(src[0] != '\0' ? "true" : "false");
+            continue;
+        }
+        writeKey(out, field.name, first);
+        switch (field.type)
+        {
+        case FieldType::boolean: {
+            bool b;
+            memcpy(&b, src, sizeof(b));
+            out.print(b ? "true" : "false");
+            break;
+        }
+        case FieldType::uint8:
+            out.print(src[0]);
+            break;
+        case FieldType::uint16: {
+            uint16_t n;
+            memcpy(&n, src, sizeof(n));
+            out.print(n);
+            break;
+        }
+        case FieldType::ip: {
+            uint32_t ip;
+            memcpy(&ip, src, sizeof(ip));
+            // Same byte order as IPAddress
+            const IPAddress address(ip);
+            out.write('"');
+            for (uint8_t b = 0; b < 4; ++b)
+            {
+                if (b != 0)
+                {
+                    out.write('.');
+                }
+                out.print(address[b]);
+            }
+            out.write('"');
+            break;
+        }
+        case FieldType::string:
+            writeString(out, reinterpret_cast<const char*>(src));
+            break;
+        }
+    }
+}
+
+bool ConfigSchema::parse(Stream& in, ConfigSection* sections, uint8_t numSections)
+{
+    for (uint8_t i = 0; i < numSections; ++i)
+    {
+        sections[i].setFields = 0;
+        sections[i].changed = false;
+    }
+    JsonReader reader(in);
+    return parseObject(reader, sections, numSections, nullptr);
+}
+
+void ConfigSchema::write(Print& out, const ConfigSection* sections, uint8_t numSections, bool redact)
+{
+    out.write('{');
+    bool first = true;
+    for (uint8_t i = 0; i < numSections; ++i)
+    {
+        const ConfigSection& s = sections[i];
+        if (s.key == nullptr)
+        {
+            if (!first)
+            {
+                out.write(',');
+            }
+            s.writeFields(out, redact);
+        }
+        else
+        {
+            writeKey(out, s.key, first);
+            out.write('{');
+            s.writeFields(out, redact);
+            out.write('}');
+        }
+        first = false;
+    }
+    out.write('}');
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Storage type of a config field
+enum class FieldType : uint8_t
+{
+    boolean, ///< bool
+    uint8, ///< uint8_t or enum with uint8_t as underlying type
+    uint16, ///< uint16_t
+    ip, ///< uint32_t holding an IPv4 address in IPAddress byte order, written as dotted string
+    string ///< char array, always null terminated
+};
+
+/// @brief Describes a single member of a config struct
+///
+/// Config structs only list their fields once in a constexpr table of descriptors. Verification, partial updates,
+/// parsing and serialization all work generically on that table.
+struct FieldDescriptor
+{
+    const char* name; ///< Json key of the field
+    FieldType type;
+    uint16_t offset; ///< Offset of the member in the struct
+    uint8_t size; ///< Size of the member, capacity including terminator for strings
+    bool required; ///< Field has to be present for the section to be complete
+    const char* redactedName; ///< Secret field, only reported as a bool with this key when redacting
+};
+
+/// @brief Declare a required field of @p Struct
+#define CONFIG_FIELD(Struct, member, key, type)                                                                        \
+    FieldDescriptor { key, type, offsetof(Struct, member), sizeof(Struct::member), true, nullptr }
+/// @brief Declare a field of @p Struct that may be missing in a complete file
+#define CONFIG_FIELD_OPTIONAL(Struct, member, key, type)                                                               \
+    FieldDescriptor { key, type, offsetof(Struct, member), sizeof(Struct::member), false, nullptr }
+/// @brief Declare a secret string field of @p Struct, which is only reported as @p redacted
+#define CONFIG_FIELD_SECRET(Struct, member, key, redacted)                                                             \
+    FieldDescriptor { key, FieldType::string, offsetof(Struct, member), sizeof(Struct::member), true, redacted }
+
+/// @brief Binds a field table to a config object
+struct ConfigSection
+{
+    template <typename T, size_t N>
+    ConfigSection(const char* key, const FieldDescriptor (&fields)[N], T& object)
+        : key(key), fields(fields), numFields(N), object(reinterpret_cast<uint8_t*>(&object))
+    {
+        static_assert(N <= 32, "Field set is tracked in 32 bits");
+    }
+
+    /// @brief Check if all required fields were set by the last parse/update
+    bool isComplete() const;
+    /// @brief Check if the field with the given key was set by the last parse/update
+    bool wasSet(const char* name) const;
+
+    /// @brief Update all fields present in object, if possible
+    /// @returns true when any value was changed
+    bool tryUpdate(const JsonObjectConst& object);
+
+    /// @brief Write all fields as json object members (without braces)
+    /// @param redact Replace secret fields by their redacted bool
+    void writeFields(Print& out, bool redact) const;
+
+    const char* key; ///< Json key of the nested object, nullptr if the fields are in the root object
+    const FieldDescriptor* fields;
+    uint8_t numFields;
+    uint8_t* object;
+    uint32_t setFields = 0; ///< Bit for each field which was set by the last parse/update
+    bool changed = false; ///< Any value was changed by the last parse/update
+};
+
+namespace ConfigSchema
+{
+    /// @brief Parse a json object from stream directly into the sections, without an intermediate document
+    ///
+    /// Unknown keys and values with a wrong type are skipped, all valid values are applied.
+    /// @returns false on a syntax error, already applied values are kept
+    bool parse(Stream& in, ConfigSection* sections, uint8_t numSections);
+
+    /// @brief Write the sections as one json object
+    /// @param redact Replace secret fields by their redacted bool
+    void write(Print& out, const ConfigSection* sections, uint8_t numSections, bool redact = false);
+} // namespace ConfigSchema
@@ -0,0 +1,251 @@
+#include "DeltaPatch.h"
+
+#if defined(ESP32)
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#endif
+
+namespace
+{
+    constexpr uint8_t opEnd = 0x00;
+    constexpr uint8_t opCopy = 0x01;
+    constexpr uint8_t opInsert = 0x02;
+
+    uint32_t readLe32(const uint8_t* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+} // namespace
+
+void DeltaPatch::reset()
+{
+    *this = DeltaPatch();
+}
+
+DeltaPatch::Result DeltaPatch::decode(
+    const uint8_t* in, size_t inLen, size_t& consumed, uint8_t* out, size_t outSize, size_t& produced)
+{
+    consumed = 0;
+    produced = 0;
+    // Account for a finished copy or insert
+    auto advance = [&](size_t n) {
+        produced += n;
+        totalProduced += n;
+        remaining -= n;
+        if (remaining == 0)
+        {
+            phase = Phase::opcode;
+        }
+    };
+    while (true)
+    {
+        switch (phase)
+        {
+        case Phase::header: {
+            if (consumed == inLen)
+            {
+                return Result::ok;
+            }
+            const size_t n = min(inLen - consumed, headerSize - headerLen);
+            memcpy(header + headerLen, in + consumed, n);
+            headerLen += n;
+            consumed += n;
+            if (headerLen == headerSize)
+            {
+                if (parseHeader() == Result::error)
+                {
+                    return Result::error;
+                }
+                phase = Phase::verify;
+            }
+            break;
+        }
+        case Phase::verify:
+            if (verifyBase() == Result::error)
+            {
+                return Result::error;
+            }
+            if (phase == Phase::verify)
+            {
+                // Hashing the whole base at once would block the loop for a long time
+                return Result::ok;
+            }
+            break;
+        case Phase::opcode:
+            if (consumed == inLen)
+            {
+                return Result::ok;
+            }
+            opcode = in[consumed++];
+            numArgs = 0;
+            varintShift = 0;
+            args[0] = 0;
+            args[1] = 0;
+            if (opcode == opEnd)
+            {
+                if (totalProduced != newSize)
+                {
+                    return fail("Patch is incomplete");
+                }
+                phase = Phase::done;
+                return Result::done;
+            }
+            else if (opcode != opCopy && opcode != opInsert)
+            {
+                return fail("Invalid patch operation");
+            }
+            phase = Phase::varint;
+            break;
+        case Phase::varint: {
+            if (consumed == inLen)
+            {
+                return Result::ok;
+            }
+            if (varintShift > 28)
+            {
+                return fail("Invalid patch number");
+            }
+            const uint8_t b = in[consumed++];
+            args[numArgs] |= (uint32_t)(b & 0x7F) << varintShift;
+            varintShift += 7;
+            if (b & 0x80)
+            {
+                break;
+            }
+            ++numArgs;
+            varintShift = 0;
+            if (opcode == opCopy)
+            {
+                if (numArgs < 2)
+                {
+                    break;
+                }
+                copyOffset = args[0];
+                remaining = args[1];
+                if (copyOffset < baseStart || copyOffset > baseEnd || remaining > baseEnd - copyOffset)
+                {
+                    return fail("Patch copy out of range");
+                }
+                phase = Phase::copy;
+            }
+            else
+            {
+                remaining = args[0];
+                phase = Phase::insert;
+            }
+            if (remaining > newSize - totalProduced)
+            {
+                return fail("Patch exceeds image size");
+            }
+            if (remaining == 0)
+            {
+                phase = Phase::opcode;
+            }
+            break;
+        }
+        case Phase::copy: {
+            if (produced == outSize)
+            {
+                return Result::ok;
+            }
+            const size_t n = min((size_t)remaining, outSize - produced);
+            if (!readBase(copyOffset, out + produced, n))
+            {
+                return fail("Reading running image failed");
+            }
+            copyOffset += n;
+            advance(n);
+            break;
+        }
+        case Phase::insert: {
+            if (produced == outSize || consumed == inLen)
+            {
+                return Result::ok;
+            }
+            const size_t n = min(min((size_t)remaining, outSize - produced), inLen - consumed);
+            memcpy(out + produced, in + consumed, n);
+            consumed += n;
+            advance(n);
+            break;
+        }
+        case Phase::done:
+            return Result::done;
+        case Phase::error:
+            return Result::error;
+        }
+    }
+}
+
+DeltaPatch::Result DeltaPatch::fail(const char* message)
+{
+    error = message;
+    phase = Phase::error;
+    return Result::error;
+}
+
+DeltaPatch::Result DeltaPatch::parseHeader()
+{
+    if (memcmp(header, "TDP1", 4) != 0)
+    {
+        return fail("Not a delta patch");
+    }
+    newSize = readLe32(header + 4);
+    static const char hex[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < 16; ++i)
+    {
+        newMd5[i * 2] = hex[header[8 + i] >> 4];
+        newMd5[i * 2 + 1] = hex[header[8 + i] & 0xF];
+    }
+    newMd5[32] = '\0';
+    baseStart = readLe32(header + 24);
+    baseEnd = readLe32(header + 28);
+    if (baseStart > baseEnd || baseEnd > ESP.getSketchSize())
+    {
+        return fail("Patch is for a different firmware");
+    }
+
+    // Check the base before anything is written, a wrong base would only be detected at the very end
+    baseMd5.begin();
+    verifyOffset = baseStart;
+    return Result::ok;
+}
+
+DeltaPatch::Result DeltaPatch::verifyBase()
+{
+    uint8_t chunk[256];
+    const uint32_t end = verifyOffset + min(verifyChunkSize, baseEnd - verifyOffset);
+    while (verifyOffset < end)
+    {
+        const uint16_t n = min((uint32_t)sizeof(chunk), end - verifyOffset);
+        if (!readBase(verifyOffset, chunk, n))
+        {
+            return fail("Reading running image failed");
+        }
+        baseMd5.add(chunk, n);
+        verifyOffset += n;
+    }
+    if (verifyOffset < baseEnd)
+    {
+        return Result::ok;
+    }
+    baseMd5.calculate();
+    uint8_t digest[16];
+    baseMd5.getBytes(digest);
+    if (memcmp(digest, header + 32, sizeof(digest)) != 0)
+    {
+        return fail("Patch is for a different firmware");
+    }
+    phase = Phase::opcode;
+    return Result::ok;
+}
+
+bool DeltaPatch::readBase(uint32_t offset, uint8_t* data, size_t len)
+{
+#if defined(ESP32)
+    static const esp_partition_t* running = esp_ota_get_running_partition();
+    return running != nullptr && esp_partition_read(running, offset, data, len) == ESP_OK;
+#else
+    // The sketch, including eboot, starts at the beginning of the flash
+    return ESP.flashRead(offset, data, len);
+#endif
+}
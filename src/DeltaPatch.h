@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD5Builder.h>
+#include <stddef.h>
+#include <stdint.h>
+
+///@brief Streaming decoder for binary patches against the running firmware image
+///
+/// Patches are created by tools/delta_patch.py. All integers are little endian.
+///
+/// Header (48 bytes):
+///  - magic "TDP1"
+///  - uint32 size of the new image
+///  - 16 byte md5 of the new image
+///  - uint32 start and uint32 end of the base range in the running image
+///  - 16 byte md5 of the base range, checked before anything is written. It is hashed in chunks over several calls
+///    of @ref decode, which produce nothing until it is done.
+///
+/// Followed by operations, lengths and offsets are LEB128 varints:
+///  - 0x00 end of patch
+///  - 0x01 offset length: copy bytes from the running image, offset must be in the base range
+///  - 0x02 length data: insert literal bytes
+class DeltaPatch
+{
+public:
+    enum class Result : uint8_t
+    {
+        ok, ///< Made progress or needs more input
+        done, ///< End of patch reached
+        error
+    };
+
+    void reset();
+
+    ///@brief Decode patch data
+    ///@param in Patch data
+    ///@param inLen Available patch data
+    ///@param consumed Number of bytes consumed from in
+    ///@param out Buffer for the new image
+    ///@param outSize Maximum number of bytes to produce
+    ///@param produced Number of bytes written to out
+    Result decode(const uint8_t* in, size_t inLen, size_t& consumed, uint8_t* out, size_t outSize, size_t& produced);
+
+    bool hasHeader() const { return phase > Phase::header; }
+    bool isDone() const { return phase == Phase::done; }
+    ///@brief True if the patch cannot make progress without more input
+    bool needsInput() const { return phase != Phase::verify && phase != Phase::copy && phase != Phase::done; }
+    uint32_t getNewSize() const { return newSize; }
+    ///@brief Md5 of the new image as hex string
+    const char* getNewMd5() const { return newMd5; }
+    const char* getError() const { return error; }
+
+private:
+    enum class Phase : uint8_t
+    {
+        header,
+        verify,
+        opcode,
+        varint,
+        copy,
+        insert,
+        done,
+        error
+    };
+
+    static constexpr size_t headerSize = 48;
+    // Bytes of the base range hashed per call of decode
+    static constexpr uint32_t verifyChunkSize = 4096;
+
+    Result fail(const char* message);
+    Result parseHeader();
+    /// @brief Hash the next chunk of the base range, compares the hash after the last one
+    Result verifyBase();
+    /// @brief Read bytes of the running image
+    static bool readBase(uint32_t offset, uint8_t* data, size_t len);
+
+private:
+    Phase phase = Phase::header;
+    uint8_t opcode = 0;
+    uint8_t numArgs = 0; // Varint arguments read for the current opcode
+    uint8_t varintShift = 0;
+    uint32_t args[2] = {};
+    uint32_t remaining = 0; // Bytes left in the current copy or insert
+    uint32_t copyOffset = 0;
+    uint32_t totalProduced = 0; // Total bytes of the new image
+    uint32_t newSize = 0;
+    uint32_t baseStart = 0;
+    uint32_t baseEnd = 0;
+    uint32_t verifyOffset = 0; // Next byte of the base range to hash
+    MD5Builder baseMd5;
+    uint8_t header[headerSize];
+    uint8_t headerLen = 0;
+    char newMd5[33] = "";
+    const char* error = "";
+};
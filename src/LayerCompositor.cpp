@@ -0,0 +1,120 @@
+#include "LayerCompositor.h"
+
+namespace
+{
+    uint8_t blendChannel(uint8_t below, uint8_t above, BlendMode mode)
+    {
+        switch (mode)
+        {
+        case BlendMode::add:
+            return qadd8(below, above);
+        case BlendMode::screen:
+            return 255 - scale8(255 - below, 255 - above);
+        case BlendMode::multiply:
+            return scale8(below, above);
+        case BlendMode::normal:
+        default:
+            return above;
+        }
+    }
+} // namespace
+
+int8_t LayerCompositor::addLayer(const CRGB* pixels, BlendMode mode, uint8_t opacity)
+{
+    if (numLayers >= maxLayers)
+    {
+        return -1;
+    }
+    layers[numLayers] = {pixels, CRGB::Black, allPixels, mode, opacity, false};
+    return numLayers++;
+}
+
+int8_t LayerCompositor::addLayer(const CRGB& color, BlendMode mode, uint8_t opacity)
+{
+    const int8_t layer = addLayer(nullptr, mode, opacity);
+    if (layer >= 0)
+    {
+        layers[layer].color = color;
+    }
+    return layer;
+}
+
+void LayerCompositor::setOpacity(uint8_t layer, uint8_t opacity)
+{
+    if (layer < numLayers)
+    {
+        layers[layer].opacity = opacity;
+    }
+}
+
+void LayerCompositor::setMask(uint8_t layer, Mask mask)
+{
+    if (layer < numLayers)
+    {
+        layers[layer].mask = mask;
+    }
+}
+
+void LayerCompositor::setVisible(uint8_t layer, bool visible)
+{
+    if (layer < numLayers)
+    {
+        layers[layer].visible = visible;
+    }
+}
+
+void LayerCompositor::compose(const CRGB* base, CRGB* output, uint8_t numPixels) const
+{
+    // Only the visible layers are looked at per pixel
+    const Layer* visible[maxLayers];
+    uint8_t numVisible = 0;
+    for (uint8_t l = 0; l < numLayers; ++l)
+    {
+        if (layers[l].visible && layers[l].opacity > 0 && layers[l].mask != 0)
+        {
+            visible[numVisible++] = &layers[l];
+        }
+    }
+    if (numVisible == 0)
+    {
+        if (output != base)
+        {
+            memmove(output, base, numPixels * sizeof(CRGB));
+        }
+        return;
+    }
+    numPixels = min(numPixels, (uint8_t)32);
+    for (uint8_t i = 0; i < numPixels; ++i)
+    {
+        CRGB c = base[i];
+        const Mask bit = (Mask)1 << i;
+        for (uint8_t l = 0; l < numVisible; ++l)
+        {
+            const Layer& layer = *visible[l];
+            if ((layer.mask & bit) == 0)
+            {
+                continue;
+            }
+            const CRGB& above = layer.pixels != nullptr ? layer.pixels[i] : layer.color;
+            for (uint8_t ch = 0; ch < 3; ++ch)
+            {
+                const uint8_t blended = blendChannel(c.raw[ch], above.raw[ch], layer.mode);
+                c.raw[ch] = layer.opacity == 255 ? blended : lerp8by8(c.raw[ch], blended, layer.opacity);
+            }
+        }
+        output[i] = c;
+    }
+}
+
+LayerCompositor::Mask LayerCompositor::maskOf(const CRGB* pixels, uint8_t numPixels)
+{
+    Mask mask = 0;
+    for (uint8_t i = 0; i < numPixels && i < 32; ++i)
+    {
+        if (pixels[i])
+        {
+            mask |= (Mask)1 << i;
+        }
+    }
+    return mask;
+}
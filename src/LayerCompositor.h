@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+enum class BlendMode : uint8_t
+{
+    normal, ///< Layer replaces the pixels below
+    add, ///< Channels are added, saturating
+    screen, ///< Inverted multiply, brightens without saturating
+    multiply ///< Darkens, white keeps the pixels below
+};
+
+///@brief Fixed stack of layers which are blended over a base frame
+///
+/// Layers do not own their pixels, they point to a buffer or have a single color. Every layer covers the pixels in
+/// its mask. All layers are blended in a single pass over the frame, so invisible layers cost nothing and visible
+/// ones only a few operations per pixel.
+class LayerCompositor
+{
+public:
+    static constexpr uint8_t maxLayers = 4;
+    using Mask = uint32_t; ///< One bit per pixel, a layer only covers pixels with a set bit
+    static constexpr Mask allPixels = 0xFFFFFFFF;
+
+    ///@brief Add a layer on top of the others
+    ///@param pixels Layer pixels, must stay valid while the layer exists
+    ///@returns Index of the layer or -1 if the stack is full
+    int8_t addLayer(const CRGB* pixels, BlendMode mode, uint8_t opacity = 255);
+    ///@brief Add a layer with a single color on top of the others
+    int8_t addLayer(const CRGB& color, BlendMode mode, uint8_t opacity = 255);
+
+    void setOpacity(uint8_t layer, uint8_t opacity);
+    void setMask(uint8_t layer, Mask mask);
+    void setVisible(uint8_t layer, bool visible);
+
+    ///@brief Blend all visible layers over base into output
+    ///@param numPixels At most 32, the mask size
+    void compose(const CRGB* base, CRGB* output, uint8_t numPixels) const;
+
+    ///@brief Mask of all pixels which are not black
+    static Mask maskOf(const CRGB* pixels, uint8_t numPixels);
+
+private:
+    struct Layer
+    {
+        const CRGB* pixels; // nullptr for a single color
+        CRGB color;
+        Mask mask;
+        BlendMode mode;
+        uint8_t opacity;
+        bool visible;
+    };
+
+    Layer layers[maxLayers];
+    uint8_t numLayers = 0;
+};
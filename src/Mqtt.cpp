@@ -1,9 +1,705 @@
 #include "Mqtt.h"
 
+#if defined(ESP32)
+#include <WiFi.h>
+#else
+#include <ESP8266WiFi.h>
+#endif
+
+namespace
+{
+    constexpr const char* discoveryPrefix = "homeassistant";
+
+    struct SpeedName
+    {
+        Speed speed;
+        const char* name;
+    };
+    constexpr SpeedName speedNames[]
+        = {{Speed::stopped, "stopped"}, {Speed::slow, "slow"}, {Speed::medium, "medium"}, {Speed::fast, "fast"}};
+
+    const char* getSpeedName(uint8_t speed)
+    {
+        for (const SpeedName& s : speedNames)
+        {
+            if ((uint8_t)s.speed == speed)
+            {
+                return s.name;
+            }
+        }
+        return "";
+    }
+
+    /// @brief Append a length prefixed string to a packet body
+    /// @returns false if the body buffer is too small
+    bool putString(uint8_t* body, size_t size, size_t& len, const char* str)
+    {
+        const size_t strLen = strlen(str);
+        if (len + 2 + strLen > size)
+        {
+            return false;
+        }
+        body[len++] = strLen >> 8;
+        body[len++] = strLen & 0xFF;
+        memcpy(body + len, str, strLen);
+        len += strLen;
+        return true;
+    }
+
+    /// @brief Check if topic is base followed by suffix
+    bool matchTopic(const char* topic, const char* base, const char* suffix)
+    {
+        const size_t baseLen = strlen(base);
+        return strncmp(topic, base, baseLen) == 0 && strcmp(topic + baseLen, suffix) == 0;
+    }
+} // namespace
+
+void Mqtt::init(TreeLight& light)
+{
+    if (this->light != nullptr)
+    {
+        return;
+    }
+    this->light = &light;
+    client.onConnect([this](void*, AsyncClient*) { sendConnect(); }, nullptr);
+    client.onData([this](void*, AsyncClient*, void* data, size_t len) { onData((const uint8_t*)data, len); }, nullptr);
+    client.onAck([this](void*, AsyncClient*, size_t, uint32_t) { sendPending(); }, nullptr);
+    client.onDisconnect(
+        [this](void*, AsyncClient*) {
+            DEBUGLN("MQTT disconnected");
+            for (uint8_t p = pending; p != 0; p &= p - 1)
+            {
+                ++numDropped;
+            }
+            pending = 0;
+            if (state != State::disabled)
+            {
+                state = State::disconnected;
+            }
+        },
+        nullptr);
+    client.onError(
+        [this](void*, AsyncClient*, int8_t error) {
+            DEBUGF("MQTT error %d\n", error);
+            if (state == State::connecting)
+            {
+                state = State::disconnected;
+            }
+        },
+        nullptr);
+}
+
+void Mqtt::update()
+{
+    const MqttConfig& mqttConfig = config.getMqttConfig();
+    if (!mqttConfig.enabled || mqttConfig.server[0] == '\0' || light == nullptr)
+    {
+        if (state != State::disabled)
+        {
+            stop();
+            state = State::disabled;
+        }
+        return;
+    }
+
+    const unsigned long now = millis();
+    switch (state)
+    {
+    case State::disabled:
+    case State::disconnected:
+        if (WiFi.isConnected() && now - lastConnectAttempt >= reconnectInterval)
+        {
+            connect();
+        }
+        break;
+    case State::connecting:
+        if (now - lastConnectAttempt > keepAlive * 1000ul)
+        {
+            DEBUGLN("MQTT connect timeout");
+            client.close(true);
+            state = State::disconnected;
+        }
+        break;
+    case State::connected:
+        if (now - lastReceive > keepAlive * 1500ul)
+        {
+            DEBUGLN("MQTT keep alive timeout");
+            client.close(true);
+            state = State::disconnected;
+            break;
+        }
+        if (now - lastSend >= keepAlive * 500ul)
+        {
+            // PINGREQ
+            sendPacket(0xC0, nullptr, 0);
+        }
+        // In case an ack was missed
+        sendPending();
+        break;
+    }
+}
+
+void Mqtt::loop()
+{
+    if (state != State::connected)
+    {
+        return;
+    }
+    if (millis() - lastPublish >= minPublishInterval)
+    {
+        queueState();
+    }
+}
+
+void Mqtt::stop()
+{
+    if (state == State::connected)
+    {
+        // DISCONNECT
+        sendPacket(0xE0, nullptr, 0);
+    }
+    if (state != State::disabled)
+    {
+        client.close();
+        state = State::disconnected;
+    }
+}
+
 void Mqtt::getStatusJsonString(JsonObject& output)
 {
     auto&& mqtt = output.createNestedObject("mqtt");
 
-    mqtt["status"] = "disabled";
+    switch (state)
+    {
+    case State::disabled:
+        mqtt["status"] = "disabled";
+        return;
+    case State::disconnected:
+        mqtt["status"] = "disconnected";
+        break;
+    case State::connecting:
+        mqtt["status"] = "connecting";
+        break;
+    case State::connected:
+        mqtt["status"] = "connected";
+        break;
+    }
+    mqtt["topic"] = baseTopic;
+    mqtt["published"] = numPublished;
+    mqtt["dropped"] = numDropped;
+}
+
+void Mqtt::connect()
+{
+    const MqttConfig& mqttConfig = config.getMqttConfig();
+    lastConnectAttempt = millis();
+    // Back off when the broker is unreachable, reset after a successful connection
+    reconnectInterval *= 2;
+    if (reconnectInterval > maxReconnectInterval)
+    {
+        reconnectInterval = maxReconnectInterval;
+    }
+    snprintf(baseTopic, sizeof(baseTopic), "%s/%s", mqttConfig.id, deviceMAC);
+    rxLength = 0;
+    rxSkip = 0;
+    state = State::connecting;
+    DEBUGF("MQTT connecting to %s:%u\n", mqttConfig.server, mqttConfig.port);
+    if (!client.connect(mqttConfig.server, mqttConfig.port))
+    {
+        state = State::disconnected;
+    }
+}
+
+void Mqtt::onConnected()
+{
+    DEBUGLN("MQTT connected");
+    state = State::connected;
+    reconnectInterval = minReconnectInterval;
+    char buffer[topicSize];
+    subscribe(makeTopic(buffer, sizeof(buffer), "/light/set"));
+    subscribe(makeTopic(buffer, sizeof(buffer), "/color/set"));
+    subscribe(makeTopic(buffer, sizeof(buffer), "/speed/set"));
+    snprintf(buffer, sizeof(buffer), "%s/status", discoveryPrefix);
+    subscribe(buffer);
+    pending = pendingOnline;
+    queueDiscovery();
 }
 
+void Mqtt::onData(const uint8_t* data, size_t len)
+{
+    lastReceive = millis();
+    while (len > 0)
+    {
+        if (rxSkip > 0)
+        {
+            const size_t n = min(rxSkip, len);
+            rxSkip -= n;
+            data += n;
+            len -= n;
+            continue;
+        }
+        const size_t n = min(len, rxBufferSize - rxLength);
+        memcpy(rxBuffer + rxLength, data, n);
+        rxLength += n;
+        data += n;
+        len -= n;
+
+        size_t pos = 0;
+        while (rxLength - pos >= 2)
+        {
+            // Decode remaining length
+            size_t remaining = 0;
+            uint8_t shift = 0;
+            size_t i = pos + 1;
+            bool complete = false;
+            while (i < rxLength && i - pos <= 4)
+            {
+                const uint8_t b = rxBuffer[i++];
+                remaining |= (size_t)(b & 0x7F) << shift;
+                shift += 7;
+                if (!(b & 0x80))
+                {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete)
+            {
+                if (i - pos > 4)
+                {
+                    DEBUGLN("MQTT malformed packet");
+                    client.close(true);
+                    rxLength = 0;
+                    return;
+                }
+                break;
+            }
+            const size_t packetLen = i - pos + remaining;
+            if (packetLen > rxBufferSize)
+            {
+                // Not interested in large packets, skip them
+                const size_t available = min(rxLength - pos, packetLen);
+                rxSkip = packetLen - available;
+                pos += available;
+                continue;
+            }
+            if (rxLength - pos < packetLen)
+            {
+                break;
+            }
+            handlePacket(rxBuffer[pos], rxBuffer + i, remaining);
+            pos += packetLen;
+        }
+        memmove(rxBuffer, rxBuffer + pos, rxLength - pos);
+        rxLength -= pos;
+    }
+}
+
+void Mqtt::handlePacket(uint8_t header, const uint8_t* body, size_t len)
+{
+    switch (header >> 4)
+    {
+    case 2: // CONNACK
+        if (len >= 2 && body[1] == 0)
+        {
+            onConnected();
+        }
+        else
+        {
+            DEBUGLN("MQTT connection refused");
+            client.close();
+        }
+        break;
+    case 3: { // PUBLISH
+        if (len < 2)
+        {
+            return;
+        }
+        const size_t topicLen = (body[0] << 8) | body[1];
+        size_t pos = 2 + topicLen;
+        if ((header >> 1) & 0x03)
+        {
+            // Packet identifier, only with QoS > 0
+            pos += 2;
+        }
+        char topicBuffer[topicSize];
+        char payload[256];
+        if (pos > len || topicLen >= sizeof(topicBuffer) || len - pos >= sizeof(payload))
+        {
+            return;
+        }
+        memcpy(topicBuffer, body + 2, topicLen);
+        topicBuffer[topicLen] = '\0';
+        memcpy(payload, body + pos, len - pos);
+        payload[len - pos] = '\0';
+        handleMessage(topicBuffer, payload);
+        break;
+    }
+    default:
+        // SUBACK, PINGRESP
+        break;
+    }
+}
+
+void Mqtt::handleMessage(const char* topic, const char* payload)
+{
+    StaticJsonDocument<128> settings;
+    if (matchTopic(topic, baseTopic, "/light/set"))
+    {
+        StaticJsonDocument<256> command;
+        if (deserializeJson(command, payload))
+        {
+            DEBUGLN("MQTT invalid light command");
+            return;
+        }
+        const char* onOff = command["state"] | "";
+        if (strcmp(onOff, "OFF") == 0)
+        {
+            settings["effect"] = (int)EffectType::off;
+        }
+        else
+        {
+            const char* effect = command["effect"] | "";
+            for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue && effect[0] != '\0'; ++i)
+            {
+                const __FlashStringHelper* name = light->getEffectName((EffectType)i);
+                if (name != nullptr && strcmp_P(effect, (PGM_P)name) == 0)
+                {
+                    settings["effect"] = i;
+                }
+            }
+            if (!settings.containsKey("effect") && light->getEffectType() == EffectType::off)
+            {
+                settings["effect"]
+                    = (int)(TreeEffects::isEnabled(lastOnEffect) ? lastOnEffect : EffectType::solid);
+            }
+            if (command["brightness"].is<uint8_t>())
+            {
+                settings["brightness"] = command["brightness"];
+            }
+        }
+    }
+    else if (matchTopic(topic, baseTopic, "/color/set"))
+    {
+        for (uint8_t i = 0; i < TreeColors::getSelectionCount(); ++i)
+        {
+            if (TreeColors::isSelectionEnabled(i) && strcmp(payload, TreeColors::getSelectionName(i)) == 0)
+            {
+                settings["color"] = i;
+            }
+        }
+    }
+    else if (matchTopic(topic, baseTopic, "/speed/set"))
+    {
+        for (const SpeedName& s : speedNames)
+        {
+            if (strcmp(payload, s.name) == 0)
+            {
+                settings["speed"] = (int)s.speed;
+            }
+        }
+    }
+    else if (matchTopic(topic, discoveryPrefix, "/status") && strcmp(payload, "online") == 0)
+    {
+        // Home Assistant restarted
+        queueDiscovery();
+        return;
+    }
+    // Same path as the web api
+    light->applySettings(settings.as<JsonObjectConst>());
+}
+
+bool Mqtt::sendConnect()
+{
+    const MqttConfig& mqttConfig = config.getMqttConfig();
+    uint8_t body[256];
+    size_t len = 0;
+    static const uint8_t protocol[] = {0, 4, 'M', 'Q', 'T', 'T', 4};
+    memcpy(body, protocol, sizeof(protocol));
+    len += sizeof(protocol);
+    // Clean session, retained will
+    uint8_t flags = 0x02 | 0x04 | 0x20;
+    if (mqttConfig.user[0] != '\0')
+    {
+        flags |= 0x80;
+        if (mqttConfig.password[0] != '\0')
+        {
+            flags |= 0x40;
+        }
+    }
+    body[len++] = flags;
+    body[len++] = keepAlive >> 8;
+    body[len++] = keepAlive & 0xFF;
+
+    char buffer[topicSize];
+    snprintf(buffer, sizeof(buffer), "%s-%s", mqttConfig.id, deviceMAC);
+    bool ok = putString(body, sizeof(body), len, buffer);
+    ok = ok && putString(body, sizeof(body), len, makeTopic(buffer, sizeof(buffer), "/status"));
+    ok = ok && putString(body, sizeof(body), len, "offline");
+    if (flags & 0x80)
+    {
+        ok = ok && putString(body, sizeof(body), len, mqttConfig.user);
+    }
+    if (flags & 0x40)
+    {
+        ok = ok && putString(body, sizeof(body), len, mqttConfig.password);
+    }
+    lastReceive = millis();
+    return ok && sendPacket(0x10, body, len);
+}
+
+bool Mqtt::subscribe(const char* topic)
+{
+    static uint16_t packetId = 0;
+    ++packetId;
+    uint8_t body[topicSize + 5];
+    size_t len = 0;
+    body[len++] = packetId >> 8;
+    body[len++] = packetId & 0xFF;
+    if (!putString(body, sizeof(body), len, topic))
+    {
+        return false;
+    }
+    // Requested QoS
+    body[len++] = 0;
+    return sendPacket(0x82, body, len);
+}
+
+bool Mqtt::publish(const char* topic, const char* payload, bool retain)
+{
+    uint8_t body[topicSize + 2];
+    size_t len = 0;
+    if (!putString(body, sizeof(body), len, topic))
+    {
+        // Can never be sent
+        ++numDropped;
+        return true;
+    }
+    if (!sendPacket(retain ? 0x31 : 0x30, body, len, payload))
+    {
+        return false;
+    }
+    ++numPublished;
+    return true;
+}
+
+bool Mqtt::sendPacket(uint8_t header, const uint8_t* body, size_t bodyLen, const char* payload)
+{
+    const size_t payloadLen = payload ? strlen(payload) : 0;
+    size_t remaining = bodyLen + payloadLen;
+    uint8_t fixedHeader[5];
+    size_t headerLen = 0;
+    fixedHeader[headerLen++] = header;
+    do
+    {
+        uint8_t b = remaining & 0x7F;
+        remaining >>= 7;
+        if (remaining > 0)
+        {
+            b |= 0x80;
+        }
+        fixedHeader[headerLen++] = b;
+    } while (remaining > 0);
+
+    if (!client.connected() || client.space() < headerLen + bodyLen + payloadLen)
+    {
+        return false;
+    }
+    client.add((const char*)fixedHeader, headerLen);
+    if (bodyLen)
+    {
+        client.add((const char*)body, bodyLen);
+    }
+    if (payloadLen)
+    {
+        client.add(payload, payloadLen);
+    }
+    client.send();
+    lastSend = millis();
+    return true;
+}
+
+void Mqtt::queueDiscovery()
+{
+    pending |= pendingLightConfig | pendingColorConfig | pendingSpeedConfig;
+    // The state is retained, but it has to follow the discovery
+    publishedState = readState();
+    pending |= pendingLightState | pendingColorState | pendingSpeedState;
+    lastPublish = millis();
+    sendPending();
+}
+
+void Mqtt::queueState()
+{
+    const LightState current = readState();
+    if (current.effect != EffectType::off)
+    {
+        lastOnEffect = current.effect;
+    }
+    if (current == publishedState)
+    {
+        return;
+    }
+    if (current.brightness != publishedState.brightness || current.effect != publishedState.effect)
+    {
+        pending |= pendingLightState;
+    }
+    if (current.color != publishedState.color)
+    {
+        pending |= pendingColorState;
+    }
+    if (current.speed != publishedState.speed)
+    {
+        pending |= pendingSpeedState;
+    }
+    publishedState = current;
+    lastPublish = millis();
+    sendPending();
+}
+
+void Mqtt::sendPending()
+{
+    while (state == State::connected && pending != 0)
+    {
+        const uint8_t item = pending & -pending;
+        if (!sendPublish(item))
+        {
+            break;
+        }
+        pending &= ~item;
+    }
+}
+
+bool Mqtt::sendPublish(uint8_t item)
+{
+    char buffer[topicSize];
+    switch (item)
+    {
+    case pendingOnline:
+        return publish(makeTopic(buffer, sizeof(buffer), "/status"), "online", true);
+    case pendingLightConfig:
+    case pendingColorConfig:
+    case pendingSpeedConfig:
+        return publishDiscovery(item);
+    default:
+        return publishState(item);
+    }
+}
+
+bool Mqtt::publishDiscovery(uint8_t item)
+{
+    char buffer[topicSize];
+    char uniqueId[24];
+    String payload;
+    payload.reserve(1024);
+    DynamicJsonDocument doc(1536);
+
+    auto addCommon = [&](const char* name, const char* component) {
+        doc["~"] = baseTopic;
+        doc["name"] = name;
+        snprintf(uniqueId, sizeof(uniqueId), "%s_%s", deviceMAC, component);
+        doc["uniq_id"] = uniqueId;
+        doc["avty_t"] = "~/status";
+        auto&& dev = doc.createNestedObject("dev");
+        dev.createNestedArray("ids").add(deviceMAC);
+        dev["name"] = HOSTNAME;
+        dev["mf"] = "enwi";
+        dev["mdl"] = "LED Christmas Tree";
+    };
+    auto send = [&](const char* component, const char* type) {
+        serializeJson(doc, payload);
+        snprintf(buffer, sizeof(buffer), "%s/%s/%s_%s/config", discoveryPrefix, type, deviceMAC, component);
+        return publish(buffer, payload.c_str(), true);
+    };
+
+    if (item == pendingLightConfig)
+    {
+        addCommon(nullptr, "light");
+        doc["schema"] = "json";
+        doc["cmd_t"] = "~/light/set";
+        doc["stat_t"] = "~/light/state";
+        doc["brightness"] = true;
+        doc["bri_scl"] = 8;
+        doc.createNestedArray("sup_clrm").add("brightness");
+        doc["effect"] = true;
+        JsonArray effects = doc.createNestedArray("fx_list");
+        for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue; ++i)
+        {
+            if ((EffectType)i != EffectType::off && TreeEffects::isEnabled((EffectType)i))
+            {
+                effects.add(light->getEffectName((EffectType)i));
+            }
+        }
+        return send("light", "light");
+    }
+    else if (item == pendingColorConfig)
+    {
+        addCommon("Colors", "color");
+        doc["cmd_t"] = "~/color/set";
+        doc["stat_t"] = "~/color/state";
+        JsonArray colors = doc.createNestedArray("options");
+        for (uint8_t i = 0; i < TreeColors::getSelectionCount(); ++i)
+        {
+            if (TreeColors::isSelectionEnabled(i))
+            {
+                colors.add(TreeColors::getSelectionName(i));
+            }
+        }
+        return send("color", "select");
+    }
+    else
+    {
+        addCommon("Speed", "speed");
+        doc["cmd_t"] = "~/speed/set";
+        doc["stat_t"] = "~/speed/state";
+        JsonArray speeds = doc.createNestedArray("options");
+        for (const SpeedName& s : speedNames)
+        {
+            speeds.add(s.name);
+        }
+        return send("speed", "select");
+    }
+}
+
+bool Mqtt::publishState(uint8_t item)
+{
+    // Always the latest state, changes since it was queued are queued again by the next loop pass
+    const LightState current = readState();
+    char buffer[topicSize];
+    if (item == pendingLightState)
+    {
+        char payload[160];
+        StaticJsonDocument<192> doc;
+        doc["state"] = current.effect != EffectType::off ? "ON" : "OFF";
+        doc["brightness"] = current.brightness;
+        doc["color_mode"] = "brightness";
+        if (current.effect != EffectType::off)
+        {
+            doc["effect"] = light->getEffectName(current.effect);
+        }
+        serializeJson(doc, payload, sizeof(payload));
+        return publish(makeTopic(buffer, sizeof(buffer), "/light/state"), payload, true);
+    }
+    else if (item == pendingColorState)
+    {
+        return publish(
+            makeTopic(buffer, sizeof(buffer), "/color/state"), TreeColors::getSelectionName(current.color), true);
+    }
+    return publish(makeTopic(buffer, sizeof(buffer), "/speed/state"), getSpeedName(current.speed), true);
+}
+
+Mqtt::LightState Mqtt::readState() const
+{
+    LightState s;
+    s.brightness = light->getBrightnessLevel();
+    s.speed = light->getSpeed();
+    s.effect = light->getEffectType();
+    s.color = light->getColors().getSelection();
+    return s;
+}
+
+const char* Mqtt::makeTopic(char* buffer, size_t size, const char* suffix) const
+{
+    snprintf(buffer, size, "%s%s", baseTopic, suffix);
+    return buffer;
+}
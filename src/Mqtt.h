@@ -2,15 +2,131 @@
 
 #include <ArduinoJson.h>
 
+#if defined(ESP32)
+#include <AsyncTCP.h>
+#else
+#include <ESPAsyncTCP.h>
+#endif
+
 #include "Constants.h"
 #include "Config.h"
+#include "TreeLight.h"
 
+///@brief Non-blocking MQTT 3.1.1 client with Home Assistant discovery
+///
+/// Only QoS 0 is used. The tree is announced as a light (brightness and effects) plus two selects for the color
+/// selection and speed. Commands are applied through @ref TreeLight::applySettings like the web api.
+///
+/// Publishes are queued as flags and their payload is created when they are sent. Whatever does not fit into the
+/// send buffer stays queued and is sent when the broker acknowledged earlier data.
 class Mqtt
 {
 public:
-    Mqtt(Config& config) { }
+    Mqtt(Config& config) : config(config) { }
+
+    ///@brief Set the light to control, has to be called before @ref update
+    void init(TreeLight& light);
+
+    ///@brief Reconnect and keep alive
+    ///
+    /// Should be called once every second
+    void update();
+
+    ///@brief Publish changed state
+    ///
+    /// Should be called every loop pass
+    void loop();
+
+    ///@brief Close the connection, for example when wifi is turned off
+    void stop();
 
     void getStatusJsonString(JsonObject& output);
 
 private:
+    enum class State : uint8_t
+    {
+        disabled,
+        disconnected,
+        connecting,
+        connected
+    };
+
+    /// Snapshot of the last published state, to only publish changes
+    struct LightState
+    {
+        uint8_t brightness = 0;
+        uint8_t speed = 0;
+        EffectType effect = EffectType::maxValue;
+        uint8_t color = 0xFF;
+
+        bool operator==(const LightState& o) const
+        {
+            return brightness == o.brightness && speed == o.speed && effect == o.effect && color == o.color;
+        }
+        bool operator!=(const LightState& o) const { return !(*this == o); }
+    };
+
+    void connect();
+    void onConnected();
+    void onData(const uint8_t* data, size_t len);
+    void handlePacket(uint8_t header, const uint8_t* body, size_t len);
+    void handleMessage(const char* topic, const char* payload);
+
+    bool sendConnect();
+    bool subscribe(const char* topic);
+    /// @returns false if it does not fit into the send buffer now
+    bool publish(const char* topic, const char* payload, bool retain = false);
+    bool sendPacket(uint8_t header, const uint8_t* body, size_t bodyLen, const char* payload = nullptr);
+
+    /// @brief Queue all discovery messages and the full state
+    void queueDiscovery();
+    /// @brief Queue the parts of the state which changed since they were last queued
+    void queueState();
+    /// @brief Send queued publishes in order until the send buffer is full
+    void sendPending();
+    /// @brief Send one queued publish
+    /// @returns false if it does not fit into the send buffer
+    bool sendPublish(uint8_t item);
+    bool publishDiscovery(uint8_t item);
+    bool publishState(uint8_t item);
+    LightState readState() const;
+
+    /// @brief Write base topic + suffix into buffer
+    const char* makeTopic(char* buffer, size_t size, const char* suffix) const;
+
+private:
+    static constexpr uint16_t keepAlive = 60; // seconds
+    static constexpr unsigned long minPublishInterval = 500; // ms, coalesce state changes
+
+    // Queued publishes, sent from the lowest bit up
+    static constexpr uint8_t pendingOnline = 0x01;
+    static constexpr uint8_t pendingLightConfig = 0x02;
+    static constexpr uint8_t pendingColorConfig = 0x04;
+    static constexpr uint8_t pendingSpeedConfig = 0x08;
+    static constexpr uint8_t pendingLightState = 0x10;
+    static constexpr uint8_t pendingColorState = 0x20;
+    static constexpr uint8_t pendingSpeedState = 0x40;
+    static constexpr unsigned long minReconnectInterval = 5000; // ms
+    static constexpr unsigned long maxReconnectInterval = 120000; // ms
+    static constexpr size_t topicSize = 96;
+    static constexpr size_t rxBufferSize = 512;
+
+    Config& config;
+    TreeLight* light = nullptr;
+    AsyncClient client;
+    State state = State::disabled;
+    char baseTopic[64] = "";
+    uint8_t rxBuffer[rxBufferSize];
+    size_t rxLength = 0;
+    size_t rxSkip = 0; // Remaining bytes of a packet which was too large for rxBuffer
+    unsigned long lastConnectAttempt = 0;
+    unsigned long reconnectInterval = minReconnectInterval;
+    unsigned long lastSend = 0;
+    unsigned long lastReceive = 0;
+    unsigned long lastPublish = 0;
+    LightState publishedState; // Last queued state
+    volatile uint8_t pending = 0; // Sent from the ack callback and the loop
+    EffectType lastOnEffect = EffectType::cycling; // Effect to restore when turned on
+    uint32_t numPublished = 0;
+    uint32_t numDropped = 0; // Queued publishes lost with the connection
 }; // namespace Mqtt
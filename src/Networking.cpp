@@ -1,15 +1,28 @@
 #include "Networking.h"
 
-#include "../webui/cpp/build.html.gz.h"
+#include <MD5Builder.h>
 
+#include "ButtonInput.h"
+#include "PowerManager.h"
+#include "Scheduler.h"
 
-// ESP32 methods do not accept arduino strings
-#if defined(ESP32)
-#define ESP32_STR(s) s.c_str()
-#else
-#define ESP32_STR(s) s
+#ifdef ESP32
+// Needs to be included separately
+#include <SPIFFS.h>
 #endif
 
+#if EMBED_WEBUI
+#include "../webui/cpp/build.html.gz.h"
+#endif
+
+namespace
+{
+    // The server adds the .gz extension and content encoding
+    constexpr const char* webUiPath = "/www/index.html";
+    constexpr const char* webUiGzPath = "/www/index.html.gz";
+    constexpr const char* webUiTempPath = "/www/upload.tmp";
+} // namespace
+
 void Networking::initWifi()
 {
     if (isInitialized)
@@ -52,13 +65,18 @@ void Networking::initWifi()
 void Networking::initServer(TreeLight& light)
 {
     server.on(
-        "/ota", HTTP_POST, [](AsyncWebServerRequest* request) { request->send(200); },
+        "/ota", HTTP_POST, [this](AsyncWebServerRequest* request) { handleOTAResponse(request); },
         [this](AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len,
-            bool final) { handleOTAUpload(request, filename, index, data, len, final); });
+            bool final) { handleOTAUpload(request, filename, index, data, len, final, false); });
+    server.on(
+        "/ota/delta", HTTP_POST, [this](AsyncWebServerRequest* request) { handleOTAResponse(request); },
+        [this](AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len,
+            bool final) { handleOTAUpload(request, filename, index, data, len, final, true); });
 
     server.on(
         "/api/status", HTTP_GET, [&light, this](AsyncWebServerRequest* request) { handleStatusApi(request, &light); });
     server.on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* r) { handleConfigApiGet(r); });
+    server.on("/api/preview", HTTP_GET, [&light, this](AsyncWebServerRequest* r) { handlePreviewApi(r, light); });
 
     AsyncCallbackJsonWebHandler* handlerSetLeds = new AsyncCallbackJsonWebHandler("/api/set_leds",
         [&light, this](AsyncWebServerRequest* request, JsonVariant& json) { handleSetLedsApi(request, json, light); });
@@ -68,10 +86,20 @@ void Networking::initServer(TreeLight& light)
         [this](AsyncWebServerRequest* request, JsonVariant& json) { handleConfigApiPost(request, json); });
     server.addHandler(handlerSetConfig);
 
+    updateIndexEtag();
     auto indexHandler = [this](AsyncWebServerRequest* r) { handleIndex(r); };
     server.on("/", HTTP_GET, indexHandler);
     server.on("/home", HTTP_GET, indexHandler);
     server.on("/config", HTTP_GET, indexHandler);
+    server.on(
+        "/api/webui", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            request->send(webUiUploadOk ? 200 : 500, "text/plain", webUiUploadOk ? "OK" : "Upload failed");
+        },
+        [this](AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len,
+            bool final) { handleWebUiUpload(request, filename, index, data, len, final); });
+    // Additional files of the web ui, their names have to change with the content
+    server.serveStatic("/assets/", SPIFFS, "/www/assets/").setCacheControl("public, max-age=31536000, immutable");
 
     // captive portal
     auto handleCaptivePortal = [this](AsyncWebServerRequest* request) { captivePortal(request); };
@@ -82,11 +110,16 @@ void Networking::initServer(TreeLight& light)
     server.onNotFound(handleCaptivePortal);
 
     server.begin();
+
+    mqtt.init(light);
+    ota.init(light);
 }
 
 void Networking::stop()
 {
     // server.end();
+    mqtt.stop();
+    captiveDns.stop();
     WiFi.mode(WIFI_OFF);
     // Save off state for reboot
     config.getNetworkConfig().wifiEnabled = false;
@@ -97,6 +130,10 @@ void Networking::stop()
 void Networking::resume()
 {
     WiFi.mode(config.getNetworkConfig().clientEnabled ? WIFI_STA : WIFI_AP);
+    if (!config.getNetworkConfig().clientEnabled)
+    {
+        captiveDns.start(WiFi.softAPIP());
+    }
     config.getNetworkConfig().wifiEnabled = true;
     config.saveConfig();
     DEBUGLN("Resuming wifi");
@@ -141,59 +178,144 @@ void Networking::getStatusJsonString(JsonObject& output)
     auto&& wifi_ap = networking.createNestedObject("wifi_ap");
     wifi_ap["status"] = client_enabled ? "disabled" : "enabled";
     wifi_ap["ip"] = WiFi.softAPIP().toString();
+
+    captiveDns.getStatusJsonString(networking);
 }
 
-void Networking::handleOTAUpload(
-    AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final)
+void Networking::handleOTAUpload(AsyncWebServerRequest* request, const String& filename, size_t index,
+    uint8_t* data, size_t len, bool final, bool delta)
 {
     if (!index)
     {
-        DEBUGLN("UploadStart");
-// calculate sketch space required for the update, for ESP32 use the max constant
-#if defined(ESP32)
-        if (!Update.begin(UPDATE_SIZE_UNKNOWN))
-#else
-        const uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
-        if (!Update.begin(maxSketchSpace))
-#endif
+        const char* md5 = nullptr;
+        if (request->hasParam("md5"))
         {
-            // start with max available size
-            Update.printError(Serial);
+            md5 = request->getParam("md5")->value().c_str();
         }
-#if defined(ESP8266)
-        Update.runAsync(true);
-#endif
+        else if (request->hasHeader("X-MD5"))
+        {
+            md5 = request->getHeader("X-MD5")->value().c_str();
+        }
+        request->onDisconnect([this]() { ota.disconnected(); });
+        // Content length includes the multipart overhead, close enough for progress
+        ota.begin(request->contentLength(), md5, delta, request->client());
     }
 
-    if (len)
-    {
-        Update.write(data, len);
-    }
+    ota.write(data, len);
 
     // if the final flag is set then this is the last frame of data
     if (final)
     {
-        if (Update.end(true))
-        {
-            // true to set the size to the current progress
-            DEBUGLN("Update Success, \nRebooting...");
-            ESP.restart();
-        }
-        else
-        {
-            Update.printError(Serial);
-        }
+        ota.end();
+    }
+}
+
+void Networking::handleOTAResponse(AsyncWebServerRequest* request)
+{
+    // The last buffered data is still being written and checked, so success is not known yet.
+    // The result is shown by the LEDs and in the status api.
+    if (ota.getState() == OtaUpdate::State::error)
+    {
+        request->send(500, "text/plain", ota.getError());
+    }
+    else
+    {
+        request->send(202, "text/plain", "Accepted");
     }
 }
 
 void Networking::handleIndex(AsyncWebServerRequest* request)
 {
-    AsyncWebServerResponse* response
-        = request->beginResponse_P(200, F("text/html"), build_html_gz_start, build_html_gz_size);
-    response->addHeader(F("Content-Encoding"), F("gzip"));
+    AsyncWebServerResponse* response;
+    if (request->hasHeader(F("If-None-Match")) && request->getHeader(F("If-None-Match"))->value() == indexEtag)
+    {
+        response = request->beginResponse(304);
+    }
+    else if (webUiInFs)
+    {
+        response = request->beginResponse(SPIFFS, webUiPath, F("text/html"));
+    }
+    else
+    {
+#if EMBED_WEBUI
+        response = request->beginResponse_P(200, F("text/html"), build_html_gz_start, build_html_gz_size);
+        response->addHeader(F("Content-Encoding"), F("gzip"));
+#else
+        request->send(404, "text/plain", "Web UI not installed, upload it to /api/webui");
+        return;
+#endif
+    }
+    // The page is small, always revalidate so a new ui is picked up immediately
+    response->addHeader(F("Cache-Control"), F("no-cache"));
+    response->addHeader(F("ETag"), indexEtag);
     request->send(response);
 }
 
+void Networking::handleWebUiUpload(
+    AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final)
+{
+    if (!index)
+    {
+        DEBUGLN("Web UI upload start");
+        webUiUploadOk = len >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+        if (!webUiUploadOk)
+        {
+            DEBUGLN("Web UI is not gzip compressed");
+            return;
+        }
+        webUiUpload = SPIFFS.open(webUiTempPath, "w");
+        webUiUploadOk = (bool)webUiUpload;
+    }
+    if (!webUiUploadOk)
+    {
+        return;
+    }
+    if (webUiUpload.write(data, len) != len)
+    {
+        DEBUGLN("Web UI upload failed, filesystem full?");
+        webUiUploadOk = false;
+        webUiUpload.close();
+        SPIFFS.remove(webUiTempPath);
+        return;
+    }
+    if (final)
+    {
+        webUiUpload.close();
+        SPIFFS.remove(webUiGzPath);
+        webUiUploadOk = SPIFFS.rename(webUiTempPath, webUiGzPath);
+        updateIndexEtag();
+        DEBUGLN("Web UI upload finished");
+    }
+}
+
+void Networking::updateIndexEtag()
+{
+    MD5Builder md5;
+    md5.begin();
+    File file = SPIFFS.open(webUiGzPath, "r");
+    webUiInFs = (bool)file;
+    if (webUiInFs)
+    {
+        md5.addStream(file, file.size());
+        file.close();
+    }
+    else
+    {
+#if EMBED_WEBUI
+        // Flash contents can only be read with aligned access on ESP8266
+        uint8_t chunk[64];
+        for (size_t offset = 0; offset < build_html_gz_size; offset += sizeof(chunk))
+        {
+            const size_t n = min(sizeof(chunk), (size_t)(build_html_gz_size - offset));
+            memcpy_P(chunk, build_html_gz_start + offset, n);
+            md5.add(chunk, n);
+        }
+#endif
+    }
+    md5.calculate();
+    snprintf(indexEtag, sizeof(indexEtag), "\"%s\"", md5.toString().c_str());
+}
+
 void Networking::handleStatusApi(AsyncWebServerRequest* request, TreeLight* light)
 {
     DynamicJsonDocument output(3000);
@@ -205,6 +327,10 @@ void Networking::handleStatusApi(AsyncWebServerRequest* request, TreeLight* ligh
 
     getStatusJsonString(obj);
     mqtt.getStatusJsonString(obj);
+    ota.getStatusJsonString(obj);
+    scheduler.getStatusJsonString(obj);
+    buttonInput.getStatusJsonString(obj);
+    powerManager.getStatusJsonString(obj);
     light->getStatusJsonString(obj);
 
     String buffer;
@@ -216,22 +342,9 @@ void Networking::handleStatusApi(AsyncWebServerRequest* request, TreeLight* ligh
 
 void Networking::handleConfigApiGet(AsyncWebServerRequest* request)
 {
-    String buffer;
-    buffer.reserve(512);
-    StaticJsonDocument<1024> document;
-    config.createJson(document);
-
-    auto&& w = document["wifi"];
-    w.remove("client_password");
-    w.remove("ap_password");
-    w["client_has_password"] = config.getNetworkConfig().clientPassword.length() != 0;
-    w["ap_has_password"] = config.getNetworkConfig().apPassword.length() != 0;
-    auto&& m = document["mqtt"];
-    m.remove("has_password");
-
-    serializeJson(document, buffer);
-
-    request->send(200, "application/json", buffer);
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    config.writeJson(*response, true);
+    request->send(response);
 }
 
 void Networking::handleConfigApiPost(AsyncWebServerRequest* request, JsonVariant& json)
@@ -239,13 +352,7 @@ void Networking::handleConfigApiPost(AsyncWebServerRequest* request, JsonVariant
 
     DEBUGLN("Received new config");
 
-    JsonObject&& data = json.as<JsonObject>();
-
-    NetworkConfig& wifi = config.getNetworkConfig();
-    bool changed = wifi.tryUpdate(data["wifi"]);
-
-    MqttConfig& mqtt = config.getMqttConfig();
-    changed |= mqtt.tryUpdate(data["mqtt"]);
+    bool changed = config.tryUpdate(json.as<JsonObjectConst>());
 
     if (changed)
     {
@@ -268,15 +375,71 @@ void Networking::handleConfigApiPost(AsyncWebServerRequest* request, JsonVariant
 void Networking::handleSetLedsApi(AsyncWebServerRequest* request, JsonVariant& json, TreeLight& light)
 {
     AsyncResponseStream* response = request->beginResponseStream("text/html");
-    JsonObject&& data = json.as<JsonObject>();
-    light.setBrightnessLevel(data["brightness"]);
-    light.setSpeed(static_cast<Speed>((uint8_t)data["speed"]));
-    light.setEffect(static_cast<EffectType>((uint8_t)data["effect"]));
-    light.setColorSelection((uint8_t)data["color"]);
+    light.applySettings(json.as<JsonObjectConst>());
     response->print("OK");
     request->send(response);
 }
 
+void Networking::handlePreviewApi(AsyncWebServerRequest* request, TreeLight& light)
+{
+    if (!request->hasParam("effect"))
+    {
+        request->send(400, "text/plain", "Missing effect");
+        return;
+    }
+    const EffectType effect = (EffectType)request->getParam("effect")->value().toInt();
+    if (!TreeEffects::isEnabled(effect))
+    {
+        request->send(400, "text/plain", "Invalid effect");
+        return;
+    }
+    uint8_t numFrames = maxPreviewFrames;
+    if (request->hasParam("frames"))
+    {
+        numFrames = constrain(request->getParam("frames")->value().toInt(), 1, (long)maxPreviewFrames);
+    }
+    unsigned long step = 100;
+    if (request->hasParam("step"))
+    {
+        step = max(request->getParam("step")->value().toInt(), 0l);
+    }
+    // The live colors are changed by the loop, which runs in another task on ESP32
+    TreeColors colors = light.getColorSnapshot();
+    if (request->hasParam("color"))
+    {
+        colors.setSelection(request->getParam("color")->value().toInt());
+    }
+    // Previews do not morph, show the selection from the first frame
+    colors.finishMorph();
+
+    if (!TreeEffects::lockOffscreen())
+    {
+        request->send(503, "text/plain", "Preview busy");
+        return;
+    }
+    // Too large for the stack of the web server task, guarded by the off-screen lock
+    static CRGB frames[maxPreviewFrames * TreeLight::numLeds];
+    TreeEffects::renderOffscreen(effect, colors, 0, step, frames, numFrames);
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    char pixel[7];
+    response->print('[');
+    for (uint8_t i = 0; i < numFrames; ++i)
+    {
+        response->print(i == 0 ? "\"" : ",\"");
+        for (uint8_t led = 0; led < TreeLight::numLeds; ++led)
+        {
+            const CRGB& c = frames[i * TreeLight::numLeds + led];
+            snprintf(pixel, sizeof(pixel), "%02x%02x%02x", c.r, c.g, c.b);
+            response->print(pixel);
+        }
+        response->print('"');
+    }
+    response->print(']');
+    // The response holds a copy of the text
+    TreeEffects::unlockOffscreen();
+    request->send(response);
+}
+
 bool Networking::isIp(const String& str)
 {
     for (size_t i = 0; i < str.length(); i++)
@@ -297,8 +460,7 @@ bool Networking::shouldEnableWifiOnStartup()
 
 void Networking::update()
 {
-    // handle DNS
-    dnsServer.processNextRequest();
+    mqtt.update();
 
     if (restartESP)
     {
@@ -306,6 +468,13 @@ void Networking::update()
     }
 }
 
+void Networking::loop()
+{
+    captiveDns.process();
+    ota.process();
+    mqtt.loop();
+}
+
 bool Networking::captivePortal(AsyncWebServerRequest* request)
 {
     if (ON_STA_FILTER(request))
@@ -363,7 +532,11 @@ void Networking::startClient()
     if (!wifi.dhcpEnabled)
     {
         DEBUGLN("Using static ip");
-        if (!WiFi.config(wifi.clientIp, wifi.clientGateway, wifi.clientMask, wifi.clientDns))
+        const IPAddress ip(wifi.clientIp);
+        const IPAddress gateway(wifi.clientGateway);
+        const IPAddress mask(wifi.clientMask);
+        const IPAddress dns(wifi.clientDns);
+        if (!WiFi.config(ip, gateway, mask, dns))
         {
             DEBUGLN("STA Failed to configure");
         }
@@ -375,7 +548,7 @@ void Networking::startClient()
 
     WiFi.persistent(true);
     WiFi.mode(WIFI_STA);
-    WiFi.begin(ESP32_STR(wifi.clientSsid), ESP32_STR(wifi.clientPassword));
+    WiFi.begin(wifi.clientSsid, wifi.clientPassword);
     DEBUG("Connecting to WiFi ..");
 
     if (handleClientFailsafe())
@@ -399,19 +572,18 @@ void Networking::startAccessPoint(bool persistent)
     WiFi.mode(WIFI_AP);
     WiFi.softAPConfig(AP_IP, AP_IP, AP_NETMASK);
 
-    if (wifi.apPassword.length() == 0)
+    if (wifi.apPassword[0] == '\0')
     {
-        WiFi.softAP(ESP32_STR(wifi.apSsid));
+        WiFi.softAP(wifi.apSsid);
         DEBUGLN("Starting open AP");
     }
     else
     {
-        WiFi.softAP(ESP32_STR(wifi.apSsid), ESP32_STR(wifi.apPassword));
+        WiFi.softAP(wifi.apSsid, wifi.apPassword);
         DEBUGLN("Starting protected AP");
     }
 
     // captive portal
     DEBUGLN("Starting DNS server");
-    dnsServer.setErrorReplyCode(DNSReplyCode::NoError);
-    dnsServer.start(53, "*", WiFi.softAPIP());
+    captiveDns.start(WiFi.softAPIP());
 }
@@ -2,14 +2,20 @@
 
 #include <ArduinoJson.h>
 #include <AsyncJson.h>
-#include <DNSServer.h>
 #include <ESPAsyncWebServer.h>
 
+#include "CaptiveDns.h"
 #include "Config.h"
 #include "Constants.h"
 #include "Mqtt.h"
+#include "OtaUpdate.h"
 #include "TreeLight.h"
 
+/// Set to 0 to remove the web ui from the firmware, it then has to be uploaded to the filesystem
+#ifndef EMBED_WEBUI
+#define EMBED_WEBUI 1
+#endif
+
 #if defined(ESP32)
 #include <Update.h>
 #else
@@ -37,18 +43,37 @@ public:
 
     ///@brief Handle the upload of binary program
     ///
+    /// The expected md5 of the image can be given as query parameter or X-MD5 header.
+    ///
     ///@param request Request coming from webserver
     ///@param filename Name of the uploading/uploaded file
     ///@param index Index of the raw @ref data within the whole 'file'
     ///@param data Raw data chunk
     ///@param len Size of the raw @ref data chunk
-    void handleOTAUpload(
-        AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final);
+    ///@param delta Upload is a patch against the running image
+    void handleOTAUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data,
+        size_t len, bool final, bool delta);
+
+    ///@brief Send the response after an upload finished
+    ///@param request Request coming from webserver
+    void handleOTAResponse(AsyncWebServerRequest* request);
 
     ///@brief Handle the index page
+    ///
+    /// Served from /www/index.html.gz in the filesystem if it exists, otherwise from the copy in the firmware.
+    /// The ETag is the md5 of the served file, browsers revalidate and get 304 if it did not change.
     ///@param request Request coming from webserver
     void handleIndex(AsyncWebServerRequest* request);
 
+    ///@brief Handle the upload of a new gzip compressed web ui to the filesystem
+    ///@param request Request coming from webserver
+    ///@param filename Name of the uploading/uploaded file
+    ///@param index Index of the raw @ref data within the whole 'file'
+    ///@param data Raw data chunk
+    ///@param len Size of the raw @ref data chunk
+    void handleWebUiUpload(
+        AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final);
+
     ///@brief Handle the status api
     ///
     ///@param request  Request coming from webserver
@@ -72,6 +97,14 @@ public:
     ///@param light TreeLight to control
     void handleSetLedsApi(AsyncWebServerRequest* request, JsonVariant& json, TreeLight& light);
 
+    ///@brief Handle the preview api, which renders frames of an effect without showing them
+    ///
+    /// Parameters: effect, optional frames (at most @ref maxPreviewFrames), step in ms of effect time and color.
+    /// Responds with an array of frames, every frame is a string of 6 hex digits per LED.
+    ///@param request Request coming from webserver
+    ///@param light TreeLight with the current colors
+    void handlePreviewApi(AsyncWebServerRequest* request, TreeLight& light);
+
     /// @brief Check if the given string is an ip address
     ///
     /// @param str String to check
@@ -83,11 +116,19 @@ public:
     /// This is the case if it was on at the last shutdown
     bool shouldEnableWifiOnStartup();
 
-    ///@brief Update DNS and other networking stuff
+    ///@brief Update MQTT and other networking stuff
     ///
     /// Should be called once every second
     void update();
 
+    ///@brief Handle networking tasks which need short response times
+    ///
+    /// Should be called every few ms, every loop pass while @ref isUpdating
+    void loop();
+
+    ///@brief True while a firmware upload is received, which is written to flash from @ref loop
+    bool isUpdating() const { return ota.getState() == OtaUpdate::State::receiving; }
+
 private:
     /// @brief Callback used for captive portal webserver
     ///
@@ -101,18 +142,27 @@ private:
     /// @return false If connection failed and access point was opened
     bool handleClientFailsafe();
 
+    /// @brief Compute the ETag of the index page and check where it is served from
+    void updateIndexEtag();
+
     /// @brief Configure wifi for client mode
     void startClient();
     /// @brief Configure wifi for access point mode
     void startAccessPoint(bool persistent = true);
 
 private:
+    static constexpr uint8_t maxPreviewFrames = 16; // Size of the static frame buffer
     const IPAddress AP_IP = {192, 168, 4, 1};
     const IPAddress AP_NETMASK = {255, 255, 255, 0};
-    DNSServer dnsServer; // DNS server for captive portal
+    CaptiveDns captiveDns; // DNS server for captive portal
     AsyncWebServer server {80}; /// Webserver for OTA
     bool isInitialized = false;
     Config& config;
     Mqtt mqtt;
+    OtaUpdate ota;
     bool restartESP = false; /// Restart ESP after config change
+    bool webUiInFs = false; /// Index page is served from the filesystem
+    bool webUiUploadOk = false;
+    File webUiUpload;
+    char indexEtag[35] = ""; /// Quoted md5 of the index page
 }; // namespace Networking
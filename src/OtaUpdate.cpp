@@ -0,0 +1,343 @@
+#include "OtaUpdate.h"
+
+#if defined(ESP32)
+#include <Update.h>
+#else
+#include <Updater.h>
+#endif
+
+namespace
+{
+    void abortUpdater()
+    {
+#if defined(ESP32)
+        Update.abort();
+#else
+        // Resets the updater when an error is set or not all data was written
+        Update.end();
+#endif
+    }
+} // namespace
+
+void OtaUpdate::begin(size_t size, const char* md5, bool delta, AsyncClient* client)
+{
+    if (state == State::receiving)
+    {
+        DEBUGLN("Aborting previous update");
+        abortUpdater();
+    }
+    DEBUGLN("UploadStart");
+    error[0] = '\0';
+    pendingError = nullptr;
+    inputComplete = false;
+    this->delta = delta;
+    this->client = client;
+    patch.reset();
+    patchHeaderApplied = false;
+    expectedSize = size;
+    written = 0;
+    bufferHead = 0;
+    bufferTail = 0;
+    startTime = millis();
+    lastData = startTime;
+
+    if (buffer == nullptr)
+    {
+        buffer = (uint8_t*)malloc(bufferSize);
+        if (buffer == nullptr)
+        {
+            fail("Not enough memory");
+            return;
+        }
+    }
+// calculate sketch space required for the update, for ESP32 use the max constant
+#if defined(ESP32)
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN))
+#else
+    const uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+    if (!Update.begin(maxSketchSpace))
+#endif
+    {
+        // start with max available size
+        failFromUpdater();
+        return;
+    }
+#if defined(ESP8266)
+    Update.runAsync(true);
+#endif
+    if (!delta && md5 != nullptr && md5[0] != '\0' && !Update.setMD5(md5))
+    {
+        fail("Invalid MD5");
+        return;
+    }
+    // Last, so process does not run before everything is set up
+    state = State::receiving;
+}
+
+void OtaUpdate::write(const uint8_t* data, size_t len)
+{
+    if (state != State::receiving || pendingError != nullptr || len == 0)
+    {
+        return;
+    }
+    lastData = millis();
+#if defined(ESP32)
+    if (!delta && bufferHead == 0 && len >= 2 && data[0] == 0x1F && data[1] == 0x8B)
+    {
+        pendingError = "Gzip images are not supported";
+        return;
+    }
+#endif
+    const size_t head = bufferHead;
+    if (len > bufferSize - (head - bufferTail))
+    {
+        pendingError = "Receive buffer overflow";
+        return;
+    }
+    const size_t pos = head % bufferSize;
+    const size_t first = min(len, bufferSize - pos);
+    memcpy(buffer + pos, data, first);
+    memcpy(buffer, data + first, len - first);
+    bufferHead = head + len;
+    if (client != nullptr)
+    {
+        // Acknowledged after it was written in process
+        client->ackLater();
+    }
+}
+
+void OtaUpdate::end()
+{
+    inputComplete = true;
+}
+
+void OtaUpdate::process()
+{
+    if (state == State::idle)
+    {
+        return;
+    }
+    // The upload can set lastData at any time, a stamp after t would make the difference wrap around
+    const unsigned long last = lastData;
+    const unsigned long t = millis();
+    if (state == State::receiving)
+    {
+        if (pendingError != nullptr)
+        {
+            fail(pendingError);
+        }
+        else
+        {
+            const size_t consumed = delta ? processDelta() : processImage();
+            const bool bufferEmpty = bufferHead == bufferTail;
+            if (state == State::receiving && client != nullptr)
+            {
+                if (bufferEmpty)
+                {
+                    // The delayed segments also contain the HTTP headers and multipart boundaries, which never reach
+                    // the buffer. Once it is empty everything received so far is written, so all of it is acknowledged.
+                    client->ack(SIZE_MAX);
+                }
+                else if (consumed > 0)
+                {
+                    client->ack(consumed);
+                }
+            }
+            if (state == State::receiving)
+            {
+                if (inputComplete && bufferEmpty && (!delta || patch.isDone() || patch.needsInput()))
+                {
+                    complete();
+                }
+                else if (!inputComplete && t - last > timeout)
+                {
+                    fail("Upload timed out");
+                }
+            }
+        }
+    }
+
+    if (light != nullptr)
+    {
+        switch (state)
+        {
+        case State::receiving:
+            light->showProgress(getProgress(), CRGB::Blue);
+            break;
+        case State::success:
+            light->showProgress(255, CRGB::Green);
+            break;
+        case State::error:
+            light->showProgress(255, CRGB::Red);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // finishTime may have been set in this call, after t
+    const unsigned long sinceFinish = millis() - finishTime;
+    if (state == State::success && sinceFinish > restartDelay)
+    {
+        ESP.restart();
+    }
+    else if (state == State::error && sinceFinish > errorDisplayTime)
+    {
+        state = State::idle;
+        if (light != nullptr)
+        {
+            light->hideProgress();
+        }
+    }
+}
+
+void OtaUpdate::getStatusJsonString(JsonObject& output)
+{
+    auto&& ota = output.createNestedObject("ota");
+    switch (state)
+    {
+    case State::idle:
+        ota["status"] = "idle";
+        break;
+    case State::receiving:
+        ota["status"] = "receiving";
+        break;
+    case State::success:
+        ota["status"] = "success";
+        break;
+    case State::error:
+        ota["status"] = "error";
+        ota["error"] = error;
+        break;
+    }
+    ota["delta"] = delta;
+    ota["received"] = bufferHead;
+    ota["written"] = written;
+    ota["size"] = expectedSize;
+    ota["progress"] = getProgress() * 100 / 255;
+    ota["throughput"] = throughput;
+}
+
+void OtaUpdate::fail(const char* message)
+{
+    DEBUG("Update failed: ");
+    DEBUGLN(message);
+    strncpy(error, message, sizeof(error) - 1);
+    error[sizeof(error) - 1] = '\0';
+    state = State::error;
+    finishTime = millis();
+    abortUpdater();
+    if (client != nullptr)
+    {
+        // Let the rest of the upload through, so the error response can be sent
+        client->ack(SIZE_MAX);
+    }
+#if defined(ESP8266)
+    // On ESP32 the upload task might still be writing into the buffer, it is reused for the next update
+    free(buffer);
+    buffer = nullptr;
+#endif
+}
+
+void OtaUpdate::failFromUpdater()
+{
+#if defined(ESP32)
+    fail(Update.errorString());
+#else
+    fail(Update.getErrorString().c_str());
+#endif
+}
+
+void OtaUpdate::complete()
+{
+    finishTime = millis();
+    const unsigned long duration = max(finishTime - startTime, 1ul);
+    throughput = (uint64_t)bufferHead * 1000 / duration;
+    DEBUGF("Upload of %u bytes took %lu ms, %u bytes/s\n", (unsigned)bufferHead, duration, (unsigned)throughput);
+    if (delta && !patch.isDone())
+    {
+        fail("Patch is incomplete");
+        return;
+    }
+    // true to set the size to the current progress
+    if (!Update.end(true))
+    {
+        failFromUpdater();
+        return;
+    }
+    DEBUGLN("Update Success, \nRebooting...");
+    state = State::success;
+}
+
+size_t OtaUpdate::processImage()
+{
+    const size_t tail = bufferTail;
+    const size_t count = bufferHead - tail;
+    if (count == 0)
+    {
+        return 0;
+    }
+    // Contiguous part of the ring buffer
+    const size_t pos = tail % bufferSize;
+    const size_t n = min(count, min((size_t)writeChunkSize, bufferSize - pos));
+    if (Update.write(buffer + pos, n) != n)
+    {
+        failFromUpdater();
+        return 0;
+    }
+    bufferTail = tail + n;
+    written += n;
+    return n;
+}
+
+size_t OtaUpdate::processDelta()
+{
+    uint8_t out[256];
+    size_t budget = writeChunkSize;
+    size_t totalConsumed = 0;
+    while (budget > 0)
+    {
+        const size_t tail = bufferTail;
+        const size_t pos = tail % bufferSize;
+        const size_t available = min(bufferHead - tail, bufferSize - pos);
+        size_t consumed = 0;
+        size_t produced = 0;
+        const DeltaPatch::Result result
+            = patch.decode(buffer + pos, available, consumed, out, min(sizeof(out), budget), produced);
+        bufferTail = tail + consumed;
+        totalConsumed += consumed;
+        if (result == DeltaPatch::Result::error)
+        {
+            fail(patch.getError());
+            break;
+        }
+        if (patch.hasHeader() && !patchHeaderApplied)
+        {
+            patchHeaderApplied = true;
+            expectedSize = patch.getNewSize();
+            Update.setMD5(patch.getNewMd5());
+        }
+        if (produced > 0 && Update.write(out, produced) != produced)
+        {
+            failFromUpdater();
+            break;
+        }
+        written += produced;
+        budget -= produced;
+        if (consumed == 0 && produced == 0)
+        {
+            // Needs more input or done
+            break;
+        }
+    }
+    return totalConsumed;
+}
+
+uint8_t OtaUpdate::getProgress() const
+{
+    if (expectedSize == 0)
+    {
+        return 0;
+    }
+    return min((uint64_t)written * 255 / expectedSize, (uint64_t)255);
+}
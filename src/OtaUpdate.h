@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#if defined(ESP32)
+#include <AsyncTCP.h>
+#else
+#include <ESPAsyncTCP.h>
+#endif
+
+#include "Constants.h"
+#include "DeltaPatch.h"
+#include "TreeLight.h"
+
+///@brief Firmware update which is received in chunks from the web server
+///
+/// The upload callbacks only copy chunks into a ring buffer and delay the TCP acknowledgement. The data is written
+/// to flash from @ref process, a limited amount per loop pass, and only then acknowledged. This throttles the sender
+/// to the flash speed, keeps sector erases out of the TCP callbacks and spreads them between frames.
+/// The upload request is answered before the last data is written, the result is only known from @ref getState.
+///
+/// The upload is either a full image or a patch against the running image (see @ref DeltaPatch).
+/// Gzip compressed full images are supported on ESP8266, where the bootloader decompresses them.
+class OtaUpdate
+{
+public:
+    enum class State : uint8_t
+    {
+        idle,
+        receiving,
+        success,
+        error
+    };
+
+    ///@brief Set the light which shows the progress
+    void init(TreeLight& light) { this->light = &light; }
+
+    ///@brief Start a new update
+    ///@param size Expected upload size in bytes, only used for progress
+    ///@param md5 Expected md5 hash of a full image as hex string, nullptr or empty to skip the check.
+    ///           Patches contain the md5 of the resulting image.
+    ///@param delta Upload is a patch instead of a full image
+    ///@param client Connection of the upload, used to delay acknowledgements
+    void begin(size_t size, const char* md5, bool delta, AsyncClient* client);
+
+    ///@brief Add a chunk of the upload
+    void write(const uint8_t* data, size_t len);
+
+    ///@brief All data was received, the update is completed by @ref process
+    void end();
+
+    ///@brief Connection of the upload was closed
+    void disconnected() { client = nullptr; }
+
+    ///@brief Write buffered data, show progress and restart after a successful update
+    ///
+    /// Should be called every loop pass
+    void process();
+
+    State getState() const { return state; }
+    const char* getError() const { return error; }
+
+    void getStatusJsonString(JsonObject& output);
+
+private:
+    void fail(const char* message);
+    void failFromUpdater();
+    void complete();
+    /// @brief Write buffered image data
+    /// @returns number of consumed bytes
+    size_t processImage();
+    /// @brief Decode buffered patch data
+    /// @returns number of consumed bytes
+    size_t processDelta();
+    /// @brief Progress from 0 to 255
+    uint8_t getProgress() const;
+
+private:
+    // Larger than the TCP window, so the sender can never overflow it
+    static constexpr size_t bufferSize = 8192;
+    // Bytes written to flash per loop pass, one flash sector is erased at most every other pass
+    static constexpr size_t writeChunkSize = 2048;
+    static constexpr unsigned long timeout = 30000; // ms without data
+    static constexpr unsigned long restartDelay = 1000; // ms to send the response before restart
+    static constexpr unsigned long errorDisplayTime = 3000; // ms
+
+    TreeLight* light = nullptr;
+    AsyncClient* client = nullptr;
+    DeltaPatch patch;
+    State state = State::idle;
+    bool delta = false;
+    bool patchHeaderApplied = false;
+    // Set by the upload callbacks, which run in a different task on ESP32
+    volatile bool inputComplete = false;
+    const char* volatile pendingError = nullptr;
+    // Ring buffer, only allocated during an update.
+    // Head is only changed by the upload callbacks, tail only by process.
+    uint8_t* buffer = nullptr;
+    volatile size_t bufferHead = 0; // Total bytes received
+    volatile size_t bufferTail = 0; // Total bytes consumed
+    size_t expectedSize = 0;
+    size_t written = 0;
+    unsigned long startTime = 0;
+    volatile unsigned long lastData = 0;
+    unsigned long finishTime = 0;
+    uint32_t throughput = 0; // bytes/s of the last finished upload
+    char error[48] = "";
+};
@@ -0,0 +1,79 @@
+#include "OutputLut.h"
+
+OutputLut::OutputLut()
+{
+    for (uint16_t i = 0; i < 256; ++i)
+    {
+        gamma16[i] = (uint16_t)(powf(i / 255.0f, gamma) * 65535.0f + 0.5f);
+    }
+}
+
+void OutputLut::setCorrection(const CRGB& correction)
+{
+    if (correction != this->correction)
+    {
+        this->correction = correction;
+        dirty = true;
+    }
+}
+
+uint32_t OutputLut::apply(const CRGB* input, uint16_t* output, uint16_t numLeds, const CRGB* calibration)
+{
+    if (dirty)
+    {
+        rebuild();
+    }
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < numLeds; ++i)
+    {
+        for (uint8_t channel = 0; channel < 3; ++channel)
+        {
+            uint16_t value = (table[channel][input[i].raw[channel]] * scale + 0x8000) >> 16;
+            if (calibration != nullptr)
+            {
+                value = (uint32_t)value * (calibration[i].raw[channel] + 1) >> 8;
+            }
+            sum += value;
+            *output++ = value;
+        }
+    }
+    return sum >> 8;
+}
+
+void OutputLut::round(const uint16_t* values, CRGB* output, uint16_t numLeds)
+{
+    uint8_t* out = output[0].raw;
+    for (uint16_t i = 0; i < numLeds * 3; ++i)
+    {
+        out[i] = (values[i] + 0x80) >> 8;
+    }
+}
+
+void OutputLut::dither(const uint16_t* values, uint8_t* error, CRGB* output, uint16_t numLeds)
+{
+    constexpr uint8_t shift = 8 - ditherBits;
+    constexpr uint8_t mask = (1 << ditherBits) - 1;
+    uint8_t* out = output[0].raw;
+    for (uint16_t i = 0; i < numLeds * 3; ++i)
+    {
+        // Round away the fractional bits which are not dithered
+        const uint16_t v = ((values[i] + (1 << (shift - 1))) >> shift) + error[i];
+        out[i] = v >> ditherBits;
+        error[i] = v & mask;
+    }
+}
+
+void OutputLut::rebuild()
+{
+    // gamma16 * correction * maxValue / (65535 * 255), maxValue / 255 is 256. The product still fits 32 bit.
+    static_assert(maxValue == 255 * 256, "Table scale");
+    for (uint8_t channel = 0; channel < 3; ++channel)
+    {
+        const uint32_t channelCorrection = correction.raw[channel];
+        for (uint16_t i = 0; i < 256; ++i)
+        {
+            table[channel][i] = (uint16_t)(((uint32_t)gamma16[i] * channelCorrection * 256 + 65535 / 2) / 65535);
+        }
+    }
+    dirty = false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+///@brief Per channel lookup table from effect colors to output values
+///
+/// Combines gamma and color correction, so the output only needs one lookup and one scale by the brightness per
+/// channel. The brightness changes with the current limit, so it is not part of the table. The table is rebuilt
+/// lazily when the correction changed. Output values have 8 fractional bits, which are either rounded or spread over
+/// the following refreshes by temporal error diffusion (dithering). This keeps smooth fades at low brightness, where
+/// an 8 bit output only has a few steps.
+/// Dithering only keeps @ref ditherBits of the fraction, so its pattern repeats after at most 8 refreshes and is too
+/// fast to be seen as flicker. More bits would need more refreshes than the LEDs can take.
+class OutputLut
+{
+public:
+    /// Highest output value, 255 with 8 fractional bits, so dithering cannot overflow
+    static constexpr uint16_t maxValue = 255 << 8;
+    /// Fractional bits spread over the refreshes by @ref dither
+    static constexpr uint8_t ditherBits = 3;
+#if defined(ESP8266)
+    /// Not measured on the ESP8266 yet, its LED output blocks interrupts during every refresh
+    static constexpr bool ditheringDefault = false;
+#else
+    static constexpr bool ditheringDefault = true;
+#endif
+
+    OutputLut();
+
+    void setBrightness(uint8_t brightness)
+    {
+        this->brightness = brightness;
+        // brightness / 255 with 16 fractional bits, 65536 at full brightness so it does not lose a step
+        scale = brightness * 257 + (brightness >> 7);
+    }
+    void setCorrection(const CRGB& correction);
+    uint8_t getBrightness() const { return brightness; }
+
+    ///@brief Map colors to output values
+    ///@param input Effect colors
+    ///@param output Output values for the LEDs, 3 per LED in rgb order
+    ///@param calibration Optional per LED scale, nullptr if not used
+    ///@returns Sum of all output channels without the fractional bits, for the current estimation
+    uint32_t apply(const CRGB* input, uint16_t* output, uint16_t numLeds, const CRGB* calibration = nullptr);
+
+    ///@brief Round output values to 8 bit
+    static void round(const uint16_t* values, CRGB* output, uint16_t numLeds);
+    ///@brief Output the next refresh of the dithered values
+    ///@param error Remaining error of each channel with @ref ditherBits, carried over to the next refresh
+    static void dither(const uint16_t* values, uint8_t* error, CRGB* output, uint16_t numLeds);
+
+private:
+    void rebuild();
+
+private:
+    static constexpr float gamma = 2.2f;
+
+    uint16_t gamma16[256]; // Input value to linear intensity, 0 to 65535
+    uint16_t table[3][256]; // Gamma and correction
+    uint8_t brightness = 255;
+    uint32_t scale = 65536;
+    CRGB correction = CRGB(255, 255, 255);
+    bool dirty = true;
+};
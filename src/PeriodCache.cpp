@@ -0,0 +1,65 @@
+#include "PeriodCache.h"
+
+bool PeriodCache::select(EffectType type, uint8_t colorVersion, unsigned long period, uint8_t numPixels)
+{
+    if (numFrames != 0 && type == this->type && colorVersion == this->colorVersion && period == this->period
+        && numPixels == this->numPixels)
+    {
+        return true;
+    }
+    this->type = type;
+    this->colorVersion = colorVersion;
+    this->period = period;
+    this->numPixels = numPixels;
+    filled = 0;
+    numFrames = numPixels == 0 ? 0 : min(budget / (numPixels * sizeof(CRGB)), (size_t)255);
+    // Interpolation needs at least two keyframes
+    if (numFrames < 2 || period == 0)
+    {
+        numFrames = 0;
+        return false;
+    }
+    return true;
+}
+
+void PeriodCache::play(CRGB* leds, unsigned long effectTime) const
+{
+    // Position in keyframes with 8 fractional bits
+    const uint32_t pos = (uint64_t)(effectTime % period) * numFrames * 256 / period;
+    const uint8_t frame = pos >> 8;
+    const CRGB* a = getFrame(frame);
+    const CRGB* b = getFrame(frame + 1 < numFrames ? frame + 1 : 0);
+    const fract8 amount = pos & 0xFF;
+    for (uint8_t i = 0; i < numPixels; ++i)
+    {
+        leds[i] = blend(a[i], b[i], amount);
+    }
+}
+
+void PeriodCache::countMiss(uint32_t renderTime)
+{
+    ++misses;
+    liveTime = renderTime;
+}
+
+void PeriodCache::countHit(uint32_t playTime)
+{
+    ++hits;
+    if (liveTime > playTime)
+    {
+        savedTime += liveTime - playTime;
+    }
+}
+
+void PeriodCache::getStatusJsonString(JsonObject& output)
+{
+    auto&& cache = output.createNestedObject("period_cache");
+    cache["size"] = budget;
+    cache["frames"] = numFrames;
+    cache["hits"] = hits;
+    cache["misses"] = misses;
+    const uint32_t total = hits + misses;
+    cache["hit_rate"] = total == 0 ? 0 : (uint64_t)hits * 100 / total;
+    // Estimated from the render time of the effect before it was cached
+    cache["saved_ms"] = (uint32_t)(savedTime / 1000);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <FastLED.h>
+
+#include "TreeEffects.h"
+
+// Bytes of RAM for cached frames, e.g. -DPERIOD_CACHE_SIZE=1280. Off by default, playing back the cache was not
+// measured to be faster than rendering the rainbow effects on the controller yet.
+#ifndef PERIOD_CACHE_SIZE
+#define PERIOD_CACHE_SIZE 0
+#endif
+
+///@brief Cache for one period of an effect which repeats over time
+///
+/// Effects which declare a period are a function of the effect time and the colors only. One period is stored as
+/// keyframes at a reduced time resolution and played back with interpolation between them. The keyframes are
+/// rendered a few per frame, so the cache is filled over the first frames after the effect or the colors changed.
+class PeriodCache
+{
+public:
+    static constexpr size_t budget = PERIOD_CACHE_SIZE;
+    ///@brief Keyframes rendered per frame while filling
+    static constexpr uint8_t fillPerFrame = 4;
+
+    ///@brief Select the effect which is cached, frames are discarded when the effect, colors or period changed
+    ///@param colorVersion Changes with every color change, see @ref TreeColors::getVersion
+    ///@returns false if the budget is too small for this number of pixels
+    bool select(EffectType type, uint8_t colorVersion, unsigned long period, uint8_t numPixels);
+    void clear() { numFrames = 0; }
+
+    bool isComplete() const { return numFrames != 0 && filled == numFrames; }
+    ///@brief Keyframe which is rendered next
+    CRGB* getFillFrame() { return getFrame(filled); }
+    ///@brief Effect time of the keyframe which is rendered next
+    unsigned long getFillTime() const { return period * filled / numFrames; }
+    void frameFilled() { ++filled; }
+
+    ///@brief Interpolate the frame at effectTime from the keyframes, the cache must be complete
+    void play(CRGB* leds, unsigned long effectTime) const;
+
+    ///@brief Count a frame which was rendered by the effect
+    void countMiss(uint32_t renderTime);
+    ///@brief Count a frame which was played from the cache
+    void countHit(uint32_t playTime);
+
+    void getStatusJsonString(JsonObject& output);
+
+private:
+    CRGB* getFrame(uint8_t frame) { return reinterpret_cast<CRGB*>(storage) + frame * numPixels; }
+    const CRGB* getFrame(uint8_t frame) const { return reinterpret_cast<const CRGB*>(storage) + frame * numPixels; }
+
+private:
+    uint8_t storage[budget > 0 ? budget : 1];
+    unsigned long period = 0;
+    EffectType type = EffectType::maxValue;
+    uint8_t colorVersion = 0;
+    uint8_t numPixels = 0;
+    uint8_t numFrames = 0; // 0 if nothing is cached
+    uint8_t filled = 0;
+
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t liveTime = 0; // us to render the last frame of the cached effect
+    uint64_t savedTime = 0; // us
+};
@@ -0,0 +1,26 @@
+#include "PixelKernels.h"
+
+namespace PixelKernels
+{
+    void nblend(CRGB* existing, const CRGB* overlay, uint16_t count, fract8 amountOfOverlay)
+    {
+        if (amountOfOverlay == 0)
+        {
+            return;
+        }
+        if (amountOfOverlay == 255)
+        {
+            memmove(existing, overlay, count * sizeof(CRGB));
+            return;
+        }
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            CRGB& e = existing[i];
+            const CRGB& o = overlay[i];
+            const uint32_t rb = blendLanes(packRB(e), packRB(o), amountOfOverlay);
+            e.g = blend8(e.g, o.g, amountOfOverlay);
+            e.r = (uint8_t)rb;
+            e.b = (uint8_t)(rb >> 16);
+        }
+    }
+} // namespace PixelKernels
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <FastLED.h>
+
+///@brief Pixel operations which process the red and blue channel together in one 32 bit word (SWAR)
+///
+/// Red and blue are packed into the lanes at bit 0 and 16, green is processed alone. A lane holds the product of
+/// a channel and a blend amount without carrying into the next lane, so one multiplication blends two channels.
+/// The results are bit-exact with the FastLED function of the same name, with the default FASTLED_BLEND_FIXED
+/// formula of the C implementation.
+namespace PixelKernels
+{
+#if FASTLED_BLEND_FIXED != 1
+#error "PixelKernels::nblend is exact with FASTLED_BLEND_FIXED only"
+#endif
+
+    constexpr uint32_t laneMask = 0x00FF00FF;
+
+    inline uint32_t packRB(const CRGB& c)
+    {
+        return (uint32_t)c.r | ((uint32_t)c.b << 16);
+    }
+
+    ///@brief Blend both lanes like blend8: (a * 256 + b + b * amount - a * amount) >> 8
+    ///
+    /// Every lane result is between 255 and 65280, so the lanes are exact even though the subtraction borrows across
+    /// them on the way.
+    inline uint32_t blendLanes(uint32_t a, uint32_t b, uint8_t amountOfB)
+    {
+        return (((a << 8) + b + b * amountOfB - a * amountOfB) >> 8) & laneMask;
+    }
+
+    ///@brief Same as nblend(existing[i], overlay[i], amountOfOverlay) for count pixels
+    void nblend(CRGB* existing, const CRGB* overlay, uint16_t count, fract8 amountOfOverlay);
+} // namespace PixelKernels
@@ -0,0 +1,98 @@
+#include "PowerManager.h"
+
+#include "Scheduler.h"
+
+#if defined(ESP32)
+#include <WiFi.h>
+#include <esp_wifi.h>
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#endif
+
+#if defined(ESP32)
+namespace
+{
+    // Lowest frequency which still supports wifi, the LED output uses RMT which does not depend on it
+    constexpr uint32_t idleCpuFrequency = 80; // MHz
+} // namespace
+#endif
+
+void PowerManager::update(bool idle)
+{
+    if (idle == this->idle)
+    {
+        return;
+    }
+    this->idle = idle;
+    if (idle)
+    {
+        enterIdle();
+    }
+    else
+    {
+        exitIdle();
+    }
+}
+
+void PowerManager::getStatusJsonString(JsonObject& output)
+{
+    auto&& power = output.createNestedObject("power");
+    power["mode"] = idle ? "idle" : "active";
+    const uint64_t total = idleTime + (idle ? millis() - idleStart : 0);
+    power["idle_seconds"] = (uint32_t)(total / 1000);
+    power["wakeups"] = numWakeups;
+#if defined(ESP8266)
+    power["cpu_mhz"] = ESP.getCpuFreqMHz();
+#elif defined(ESP32)
+    power["cpu_mhz"] = getCpuFrequencyMhz();
+#endif
+}
+
+void PowerManager::enterIdle()
+{
+    DEBUGLN("Entering idle mode");
+    idleStart = millis();
+    scheduler.setIdle(true);
+#if defined(ESP32)
+    activeCpuFrequency = getCpuFrequencyMhz();
+    if (activeCpuFrequency > idleCpuFrequency)
+    {
+        setCpuFrequencyMhz(idleCpuFrequency);
+    }
+    if (WiFi.getMode() == WIFI_STA)
+    {
+        // Only wakes up for DTIM beacons
+        esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+    }
+#elif defined(ESP8266)
+    // The cpu frequency is not changed, the LED output timing depends on F_CPU
+    if (WiFi.getMode() == WIFI_STA)
+    {
+        // Sleeps between DTIM beacons while the loop is in delay
+        WiFi.setSleepMode(WIFI_LIGHT_SLEEP);
+    }
+#endif
+}
+
+void PowerManager::exitIdle()
+{
+    ++numWakeups;
+    idleTime += millis() - idleStart;
+    scheduler.setIdle(false);
+#if defined(ESP32)
+    if (activeCpuFrequency > idleCpuFrequency)
+    {
+        setCpuFrequencyMhz(activeCpuFrequency);
+    }
+    if (WiFi.getMode() == WIFI_STA)
+    {
+        esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    }
+#elif defined(ESP8266)
+    if (WiFi.getMode() == WIFI_STA)
+    {
+        WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+    }
+#endif
+    DEBUGLN("Leaving idle mode");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "Constants.h"
+
+///@brief Saves power while the LED output is static
+///
+/// In idle mode the scheduler runs its tasks less often, so more time is spent in delay where the SDK can sleep.
+/// In client mode wifi uses maximum modem sleep on ESP32 and light sleep on ESP8266, both wake up for DTIM beacons
+/// so the web server stays reachable. The access point cannot sleep, it has to answer its clients.
+/// On ESP32 the cpu frequency is lowered as well.
+class PowerManager
+{
+public:
+    ///@brief Enter or leave idle mode
+    void update(bool idle);
+
+    bool isIdle() const { return idle; }
+
+    void getStatusJsonString(JsonObject& output);
+
+private:
+    void enterIdle();
+    void exitIdle();
+
+private:
+    bool idle = false;
+#if defined(ESP32)
+    uint32_t activeCpuFrequency = 0; // MHz
+#endif
+    unsigned long idleStart = 0;
+    uint64_t idleTime = 0; // ms, without the current idle period
+    uint32_t numWakeups = 0;
+};
+
+/// Power management of the tree
+extern PowerManager powerManager;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+///@brief Small seedable pseudo random number generator (xorshift32)
+///
+/// Used instead of Arduino random, so the same seed always gives the same colors and previews can continue the
+/// sequence of the tree from a copy.
+class Prng
+{
+public:
+    ///@brief Start a new sequence, every seed gives a different one
+    void seed(uint32_t value)
+    {
+        state = value;
+        if (state == 0)
+        {
+            // Zero is the only state xorshift cannot leave
+            state = defaultSeed;
+        }
+    }
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    ///@brief Random number from min to max - 1 like Arduino random, min if the range is empty
+    int32_t random(int32_t min, int32_t max)
+    {
+        if (max <= min)
+        {
+            return min;
+        }
+        return min + (int32_t)(next() % (uint32_t)(max - min));
+    }
+
+private:
+    static constexpr uint32_t defaultSeed = 2463534242;
+
+    uint32_t state = defaultSeed;
+};
@@ -0,0 +1,126 @@
+#include "Scheduler.h"
+
+bool Scheduler::addTask(
+    const char* name, Callback* callback, uint32_t period, uint32_t idlePeriod, Priority priority, uint32_t budget)
+{
+    if (numTasks == maxTasks)
+    {
+        DEBUGLN("Too many tasks");
+        return false;
+    }
+    // Keep the tasks sorted by priority, in order of registration within the same priority
+    uint8_t i = numTasks;
+    for (; i > 0 && tasks[i - 1].priority > priority; --i)
+    {
+        tasks[i] = tasks[i - 1];
+    }
+    tasks[i] = Task {name, callback, period, idlePeriod, budget, priority, millis(), 0, 0, 0, 0, 0};
+    ++numTasks;
+    return true;
+}
+
+void Scheduler::setPeriod(Callback* callback, uint32_t period)
+{
+    for (uint8_t i = 0; i < numTasks; ++i)
+    {
+        if (tasks[i].callback == callback)
+        {
+            tasks[i].period = period;
+        }
+    }
+}
+
+void Scheduler::run()
+{
+    const uint32_t passStart = micros();
+    if (lastPass != 0)
+    {
+        elapsed += passStart - lastPass;
+    }
+    lastPass = passStart;
+    for (uint8_t i = 0; i < numTasks; ++i)
+    {
+        Task& task = tasks[i];
+        const uint32_t now = millis();
+        if (now - task.lastRun < getPeriod(task))
+        {
+            continue;
+        }
+        if (task.priority == Priority::low && micros() - passStart > timeSlice)
+        {
+            ++task.deferred;
+            continue;
+        }
+        task.lastRun = now;
+        const uint32_t start = micros();
+        task.callback();
+        const uint32_t duration = micros() - start;
+        ++task.runs;
+        task.totalTime += duration;
+        if (duration > task.maxTime)
+        {
+            task.maxTime = duration;
+        }
+        if (duration > task.budget)
+        {
+            ++task.overruns;
+        }
+    }
+
+    const uint32_t wait = getIdleTime(millis());
+    const uint32_t idleStart = micros();
+    if (wait > 0)
+    {
+        delay(wait);
+    }
+    else
+    {
+        // Let the SDK handle wifi
+        yield();
+    }
+    idleTime += micros() - idleStart;
+}
+
+void Scheduler::getStatusJsonString(JsonObject& output)
+{
+    auto&& scheduler = output.createNestedObject("scheduler");
+    if (elapsed == 0)
+    {
+        return;
+    }
+    scheduler["idle_percent"] = (float)idleTime * 100 / elapsed;
+    JsonArray tasksArray = scheduler.createNestedArray("tasks");
+    for (uint8_t i = 0; i < numTasks; ++i)
+    {
+        const Task& task = tasks[i];
+        JsonObject t = tasksArray.createNestedObject();
+        t["name"] = task.name;
+        t["priority"] = (uint8_t)task.priority;
+        t["cpu_percent"] = (float)task.totalTime * 100 / elapsed;
+        t["runs"] = task.runs;
+        t["max_us"] = task.maxTime;
+        t["overruns"] = task.overruns;
+        t["deferred"] = task.deferred;
+    }
+}
+
+uint32_t Scheduler::getIdleTime(uint32_t now) const
+{
+    uint32_t wait = maxIdleTime;
+    for (uint8_t i = 0; i < numTasks; ++i)
+    {
+        const Task& task = tasks[i];
+        const uint32_t sinceRun = now - task.lastRun;
+        const uint32_t period = getPeriod(task);
+        if (sinceRun >= period)
+        {
+            return 0;
+        }
+        const uint32_t remaining = period - sinceRun;
+        if (remaining < wait)
+        {
+            wait = remaining;
+        }
+    }
+    return wait;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "Constants.h"
+
+///@brief Cooperative scheduler for the main loop
+///
+/// Tasks run when their period elapsed, in order of priority. Once a pass used up its time slice, the remaining
+/// low priority tasks are deferred to the next pass, so housekeeping cannot delay frame output for long.
+/// Tasks taking longer than their budget are counted as overruns. The time until the next task is due is spent in
+/// delay, which lets the SDK sleep.
+class Scheduler
+{
+public:
+    using Callback = void();
+
+    enum class Priority : uint8_t
+    {
+        high, ///< Always runs when due
+        normal,
+        low ///< Deferred when the time slice is used up
+    };
+
+    ///@brief Register a task
+    ///@param name Name shown in the status, has to stay valid
+    ///@param callback Function to run
+    ///@param period Minimum ms between two runs, 0 to run every pass
+    ///@param idlePeriod Period used in idle mode
+    ///@param priority Tasks with higher priority run first
+    ///@param budget Expected maximum run time in us, longer runs are counted as overruns
+    ///@returns false if there is no space for the task
+    bool addTask(const char* name, Callback* callback, uint32_t period, uint32_t idlePeriod, Priority priority,
+        uint32_t budget);
+
+    ///@brief Change the period of a task outside of idle mode
+    ///@param callback Function of the task
+    ///@param period Minimum ms between two runs, 0 to run every pass
+    void setPeriod(Callback* callback, uint32_t period);
+
+    ///@brief Switch all tasks to their idle periods, so more time is spent sleeping
+    void setIdle(bool idle) { this->idle = idle; }
+
+    ///@brief Run all due tasks, then wait until the next one is due
+    ///
+    /// Should be called from loop
+    void run();
+
+    void getStatusJsonString(JsonObject& output);
+
+private:
+    struct Task
+    {
+        const char* name;
+        Callback* callback;
+        uint32_t period; // ms
+        uint32_t idlePeriod; // ms
+        uint32_t budget; // us
+        Priority priority;
+        uint32_t lastRun; // ms
+        uint32_t runs;
+        uint32_t overruns;
+        uint32_t deferred;
+        uint32_t maxTime; // us
+        uint64_t totalTime; // us
+    };
+
+    ///@brief ms until the next task is due
+    uint32_t getIdleTime(uint32_t now) const;
+    uint32_t getPeriod(const Task& task) const { return idle ? task.idlePeriod : task.period; }
+
+private:
+    static constexpr uint8_t maxTasks = 8;
+    static constexpr uint32_t timeSlice = 8000; // us per pass before low priority tasks are deferred
+    static constexpr uint32_t maxIdleTime = 100; // ms, to keep the loop responsive
+
+    Task tasks[maxTasks];
+    uint8_t numTasks = 0;
+    bool idle = false;
+    // 64 bit, so the totals do not overflow after 71 minutes
+    uint64_t elapsed = 0; // us
+    uint64_t idleTime = 0; // us
+    uint32_t lastPass = 0; // us
+};
+
+/// Scheduler running the main loop
+extern Scheduler scheduler;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "TreeEffects.h"
+
+/// Part of the tree with its own effect
+struct SegmentConfig
+{
+    bool enabled = false;
+    uint8_t start = 0; ///< First LED
+    uint8_t end = 0; ///< Last LED, included
+    EffectType effect = EffectType::solid;
+    uint8_t colorSelection = 0;
+    uint8_t speed = 2;
+
+    bool operator==(const SegmentConfig& other) const
+    {
+        return enabled == other.enabled && start == other.start && end == other.end && effect == other.effect
+            && colorSelection == other.colorSelection && speed == other.speed;
+    }
+    bool operator!=(const SegmentConfig& other) const { return !(*this == other); }
+};
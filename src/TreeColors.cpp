@@ -11,9 +11,11 @@ namespace
     // A mostly (dark) green palette with red berries.
     constexpr uint32_t Holly_Green = 0x00580c;
     constexpr uint32_t Holly_Red = 0xB00402;
+#if PALETTE_HOLLY
     const TProgmemRGBPalette16 Holly_p FL_PROGMEM
         = {Holly_Green, Holly_Green, Holly_Green, Holly_Green, Holly_Green, Holly_Green, Holly_Green, Holly_Green,
             Holly_Green, Holly_Green, Holly_Green, Holly_Green, Holly_Red, Holly_Red, Holly_Red, Holly_Red};
+#endif
 
     // A red and white striped palette
     // "CRGB::Gray" is used as white to keep the brightness more uniform.
@@ -30,13 +32,17 @@ namespace
     // A pure "fairy light" palette with some brightness variations
     constexpr uint32_t HALFFAIRY = ((CRGB::FairyLight & 0xFEFEFE) / 2);
     constexpr uint32_t QUARTERFAIRY = ((CRGB::FairyLight & 0xFCFCFC) / 4);
+#if PALETTE_FAIRY_LIGHT
     const TProgmemRGBPalette16 FairyLight_p FL_PROGMEM = {CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight,
         CRGB::FairyLight, HALFFAIRY, HALFFAIRY, CRGB::FairyLight, CRGB::FairyLight, QUARTERFAIRY, QUARTERFAIRY,
         CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight, CRGB::FairyLight};
+#endif
 
     // A palette of soft snowflakes with the occasional bright one
+#if PALETTE_SNOW
     const TProgmemRGBPalette16 Snow_p FL_PROGMEM = {0x304048, 0x304048, 0x304048, 0x304048, 0x304048, 0x304048,
         0x304048, 0x304048, 0x304048, 0x304048, 0x304048, 0x304048, 0xE0F0FF, 0xE0F0FF, 0xE0F0FF, 0xE0F0FF};
+#endif
 
     // A palette reminiscent of large 'old-school' C9-size tree lights
     // in the five classic colors: red, orange, green, blue, and white.
@@ -45,8 +51,28 @@ namespace
     constexpr uint32_t C9_Green = 0x046002;
     constexpr uint32_t C9_Blue = 0x070758;
     constexpr uint32_t C9_White = 0x606820;
+#if PALETTE_RETRO_C9
     const TProgmemRGBPalette16 RetroC9_p FL_PROGMEM = {C9_Red, C9_Orange, C9_Red, C9_Orange, C9_Orange, C9_Red,
         C9_Orange, C9_Red, C9_Green, C9_Green, C9_Green, C9_Green, C9_Blue, C9_Blue, C9_Blue, C9_White};
+#endif
+
+    ///@brief Move every channel of color by at most step towards target
+    ///@returns true if color did not reach target
+    bool stepToward(CRGB& color, const CRGB& target, uint8_t step)
+    {
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            if (color[i] < target[i])
+            {
+                color[i] = target[i] - color[i] > step ? color[i] + step : target[i];
+            }
+            else if (color[i] > target[i])
+            {
+                color[i] = color[i] - target[i] > step ? color[i] - step : target[i];
+            }
+        }
+        return color != target;
+    }
 
     ///@brief Generate a harmonic color to the given @ref color
     ///
@@ -66,13 +92,14 @@ namespace
     ///@param rangeAngle2 [0-255]
     ///@param saturation Saturation of the generated color [0-255]
     ///@param luminance Luminance of the generated color [0-255]
+    ///@param prng Random number generator for the angle
     ///@return CRGB
     CRGB GenerateHarmonicColor(const CHSV color, uint8_t offsetAngle1, uint8_t offsetAngle2, uint8_t rangeAngle0,
-        uint8_t rangeAngle1, uint8_t rangeAngle2, uint8_t saturation, uint8_t luminance)
+        uint8_t rangeAngle1, uint8_t rangeAngle2, uint8_t saturation, uint8_t luminance, Prng& prng)
     {
         // const uint8_t referenceAngle = random(0, 256);
         const uint8_t referenceAngle = color.h;
-        uint8_t randomAngle = random(1, 255) * (rangeAngle0 + rangeAngle1 + rangeAngle2) / 256;
+        uint8_t randomAngle = prng.random(1, 255) * (rangeAngle0 + rangeAngle1 + rangeAngle2) / 256;
 
         if (randomAngle > rangeAngle0)
         {
@@ -89,15 +116,45 @@ namespace
         return CHSV(referenceAngle + randomAngle, saturation, luminance);
     }
 
+#if PALETTE_HOLLY
+#define PALETTE_HOLLY_P &Holly_p
+#else
+#define PALETTE_HOLLY_P nullptr
+#endif
+#if PALETTE_RETRO_C9
+#define PALETTE_RETRO_C9_P &RetroC9_p
+#else
+#define PALETTE_RETRO_C9_P nullptr
+#endif
+#if PALETTE_FAIRY_LIGHT
+#define PALETTE_FAIRY_LIGHT_P &FairyLight_p
+#else
+#define PALETTE_FAIRY_LIGHT_P nullptr
+#endif
+#if PALETTE_SNOW
+#define PALETTE_SNOW_P &Snow_p
+#else
+#define PALETTE_SNOW_P nullptr
+#endif
+
     const TProgmemRGBPalette16* palettes[] = {nullptr, // harmonic colors
         nullptr, //
-        &Holly_p, //
-        &RetroC9_p, //
-        &FairyLight_p, //
-        &Snow_p, //
+        PALETTE_HOLLY_P, //
+        PALETTE_RETRO_C9_P, //
+        PALETTE_FAIRY_LIGHT_P, //
+        PALETTE_SNOW_P, //
         nullptr, //
         nullptr};
     constexpr uint8_t paletteCount = sizeof(palettes) / sizeof(TProgmemRGBPalette16*);
+    // Generated colors are always available
+    constexpr bool paletteEnabled[paletteCount] = {true, //
+        true, //
+        PALETTE_HOLLY != 0, //
+        PALETTE_RETRO_C9 != 0, //
+        PALETTE_FAIRY_LIGHT != 0, //
+        PALETTE_SNOW != 0, //
+        true, //
+        true};
     const char* paletteNames[paletteCount] = {"Random Rainbow", //
         "Random Pastel", //
         "Holly", //
@@ -111,43 +168,100 @@ namespace
 
 void TreeColors::initRandomColors()
 {
-    color1 = CRGB(random(0, 255), random(0, 255), random(0, 255));
-    color2 = CRGB(random(0, 255), random(0, 255), random(0, 255));
+    color1 = CRGB(prng.random(0, 255), prng.random(0, 255), prng.random(0, 255));
+    color2 = CRGB(prng.random(0, 255), prng.random(0, 255), prng.random(0, 255));
+    ++version;
 }
 
 void TreeColors::setSelection(uint8_t index)
 {
-    if (index != selection)
+    if (index != selection && isSelectionEnabled(index))
     {
         const TProgmemRGBPalette16* palette = getPaletteSelection(index);
         if (palette != nullptr)
         {
-            currentPalette = *palette;
+            targetPalette = *palette;
         }
         else
         {
-            fill_solid(currentPalette, 16, CRGB::Black);
+            fill_solid(targetPalette, 16, CRGB::Black);
         }
         selection = index;
+        // Pick two new colors, but keep showing the current ones until morph reaches them
+        const CRGB shown1 = color1;
+        const CRGB shown2 = color2;
         updateColor();
         updateColor();
+        targetColor1 = color1;
+        targetColor2 = color2;
+        color1 = shown1;
+        color2 = shown2;
+        colorsMorphing = true;
+        paletteMorphing = currentPalette != targetPalette;
+    }
+}
+
+bool TreeColors::morph()
+{
+    if (!isMorphing())
+    {
+        return false;
+    }
+    if (colorsMorphing)
+    {
+        // Both colors always take a step
+        const bool first = stepToward(color1, targetColor1, colorStep);
+        const bool second = stepToward(color2, targetColor2, colorStep);
+        colorsMorphing = first || second;
+    }
+    if (paletteMorphing)
+    {
+        nblendPaletteTowardPalette(currentPalette, targetPalette, paletteChanges);
+        paletteMorphing = currentPalette != targetPalette;
+    }
+    if (isMorphing())
+    {
+        return true;
+    }
+    // Only once at the end, so the colors of every frame do not invalidate caches
+    ++version;
+    return false;
+}
+
+void TreeColors::finishMorph()
+{
+    if (colorsMorphing)
+    {
+        color1 = targetColor1;
+        color2 = targetColor2;
+        colorsMorphing = false;
     }
+    currentPalette = targetPalette;
+    paletteMorphing = false;
+    ++version;
 }
 
 void TreeColors::updateColor()
 {
+    if (colorsMorphing)
+    {
+        // The next color follows the color of the selection
+        color2 = targetColor2;
+        colorsMorphing = false;
+    }
     color1 = color2;
+    ++version;
 
     CRGB colorDifference;
     for (uint8_t i = 0; i < 4; ++i)
     {
         if (isColorPalette())
         {
-            color2 = ColorFromPalette(currentPalette, random(0, 255));
+            color2 = ColorFromPalette(targetPalette, prng.random(0, 255));
         }
         else
         {
-            color2 = generateColor(selection, color2);
+            color2 = generateColor(selection, color2, prng);
         }
         colorDifference = color1;
         colorDifference -= color2;
@@ -158,6 +272,48 @@ void TreeColors::updateColor()
     }
 }
 
+CRGB TreeColors::getSequenceColor(uint32_t step) const
+{
+    if (step == 0)
+    {
+        return color1;
+    }
+    if (step == 1)
+    {
+        return color2;
+    }
+    // Like updateColor, skip colors too close to the last one. Only its first attempt is compared, so the cost does
+    // not grow with the step.
+    const CRGB previous = step == 2 ? color2 : generateSequenceColor(step - 1, 0);
+    CRGB color;
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        color = generateSequenceColor(step, i);
+        CRGB colorDifference = previous;
+        colorDifference -= color;
+        if (colorDifference.getAverageLight() > 8)
+        {
+            break;
+        }
+    }
+    return color;
+}
+
+CRGB TreeColors::generateSequenceColor(uint32_t step, uint8_t attempt) const
+{
+    // While morphing, the sequence already continues from the colors of the new selection
+    const CRGB base1 = colorsMorphing ? targetColor1 : color1;
+    const CRGB base2 = colorsMorphing ? targetColor2 : color2;
+    Prng sequencePrng;
+    sequencePrng.seed(((uint32_t)base1.r << 16 | (uint32_t)base1.g << 8 | base1.b) * 2654435761u
+        ^ ((uint32_t)base2.r << 16 | (uint32_t)base2.g << 8 | base2.b) ^ (step * 4 + attempt) * 2246822519u);
+    if (isColorPalette())
+    {
+        return ColorFromPalette(targetPalette, sequencePrng.random(0, 255));
+    }
+    return generateColor(selection, base2, sequencePrng);
+}
+
 bool TreeColors::isColorPalette() const
 {
     return getPaletteSelection(selection) != nullptr;
@@ -189,26 +345,26 @@ CRGB TreeColors::getPaletteColor(uint8_t mix, bool doBlend) const
     }
 }
 
-CRGB TreeColors::generateColor(uint8_t selection, CRGB baseColor)
+CRGB TreeColors::generateColor(uint8_t selection, CRGB baseColor, Prng& prng)
 {
     switch (selection)
     {
     case 0:
         // Random rainbow
-        return GenerateHarmonicColor(rgb2hsv_approximate(baseColor), 16, 32, 8, 16, 32, 255, 255);
+        return GenerateHarmonicColor(rgb2hsv_approximate(baseColor), 16, 32, 8, 16, 32, 255, 255, prng);
     case 1:
         // Random pastel
-        return GenerateHarmonicColor(rgb2hsv_approximate(baseColor), 16, 32, 8, 16, 32, 128, 255);
+        return GenerateHarmonicColor(rgb2hsv_approximate(baseColor), 16, 32, 8, 16, 32, 128, 255, prng);
     case 6: {
         // Reds
         // TODO: Range is only applied towards positive hues, which is why the starting color is shifted here
-        uint8_t brightness = random(200, 255);
-        return GenerateHarmonicColor(CHSV(HUE_RED - 16, 255, 255), 0, 0, 32, 0, 0, 255, brightness);
+        uint8_t brightness = prng.random(200, 255);
+        return GenerateHarmonicColor(CHSV(HUE_RED - 16, 255, 255), 0, 0, 32, 0, 0, 255, brightness, prng);
     }
     case 7: {
         // Greens
-        uint8_t brightness = random(200, 255);
-        return GenerateHarmonicColor(CHSV(HUE_GREEN - 16, 255, 255), 0, 0, 32, 0, 0, 255, brightness);
+        uint8_t brightness = prng.random(200, 255);
+        return GenerateHarmonicColor(CHSV(HUE_GREEN - 16, 255, 255), 0, 0, 32, 0, 0, 255, brightness, prng);
     }
     default:
         return CRGB::Black;
@@ -237,3 +393,8 @@ uint8_t TreeColors::getSelectionCount()
 {
     return paletteCount;
 }
+
+bool TreeColors::isSelectionEnabled(uint8_t i)
+{
+    return i < paletteCount && paletteEnabled[i];
+}
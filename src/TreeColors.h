@@ -4,18 +4,55 @@
 #include <FastLED.h>
 #include <stdint.h>
 
+#include "Prng.h"
+
+// Build flags to leave out color palettes, e.g. -DPALETTE_SNOW=0
+#ifndef PALETTE_HOLLY
+#define PALETTE_HOLLY 1
+#endif
+#ifndef PALETTE_RETRO_C9
+#define PALETTE_RETRO_C9 1
+#endif
+#ifndef PALETTE_FAIRY_LIGHT
+#define PALETTE_FAIRY_LIGHT 1
+#endif
+#ifndef PALETTE_SNOW
+#define PALETTE_SNOW 1
+#endif
+
 class TreeColors
 {
 public:
+    ///@brief Seed the random colors, the same seed and calls give the same colors
+    void seed(uint32_t value) { prng.seed(value); }
+    ///@brief Random byte from the same sequence as the colors, for randomness that has to repeat with them
+    uint8_t randomByte() { return prng.random(0, 256); }
     // Initialize colors to random values
     void initRandomColors();
 
-    // Set color selection and update colors if changed
+    // Set color selection and update colors if changed, the new colors are shown gradually by morph
     void setSelection(uint8_t index);
+    ///@brief Move the palette and colors a step towards the selection, called once per frame
+    ///
+    /// Changes at most @ref paletteChanges palette bytes and the two colors by @ref colorStep per channel.
+    ///@returns true if the colors still change
+    bool morph();
+    ///@brief Show the colors of the selection immediately
+    void finishMorph();
+    bool isMorphing() const { return paletteMorphing || colorsMorphing; }
     uint8_t getSelection() const { return selection; }
+    ///@brief Changes whenever the colors or the palette change
+    ///
+    /// A morph only changes it when it ends, the colors change in every frame before while @ref isMorphing is true.
+    uint8_t getVersion() const { return version; }
 
     // Set first color to second color and choose new second color
     void updateColor();
+    ///@brief Color number step of a sequence, which starts with the first and the second color
+    ///
+    /// The following colors are random colors of the selection, seeded from the colors and the step. So effects can
+    /// show a new color every period as a function of the time only, without changing the colors.
+    CRGB getSequenceColor(uint32_t step) const;
 
     CRGB firstColor() const { return color1; }
     CRGB secondColor() const { return color2; }
@@ -28,18 +65,32 @@ public:
 
     static const char* getSelectionName(uint8_t i);
     static uint8_t getSelectionCount();
+    ///@brief Disabled selections keep their index, but cannot be selected
+    static bool isSelectionEnabled(uint8_t i);
+
+    static constexpr uint8_t paletteChanges = 48;
+    static constexpr uint8_t colorStep = 2;
 
 private:
     // returns nullptr if selection is not a palette
     static const TProgmemRGBPalette16* getPaletteSelection(uint8_t i);
     // Generate color for selection which is not a palette
-    static CRGB generateColor(uint8_t selection, CRGB baseColor);
+    static CRGB generateColor(uint8_t selection, CRGB baseColor, Prng& prng);
+    // Random color of the selection for getSequenceColor, from prng seeded for the step
+    CRGB generateSequenceColor(uint32_t step, uint8_t attempt) const;
 
 private:
     CRGB color1 = CRGB(0, 0xA0, 0xFF);
     CRGB color2 = CRGB(0, 0x40, 0xFF);
-    CRGBPalette16 currentPalette {CRGB::Black};
+    CRGBPalette16 currentPalette {CRGB::Black}; // Shown palette
+    CRGBPalette16 targetPalette {CRGB::Black}; // Palette of the selection
+    CRGB targetColor1; // Colors of the selection, while colorsMorphing
+    CRGB targetColor2;
+    bool paletteMorphing = false;
+    bool colorsMorphing = false;
+    Prng prng; // Part of the color state, so copies continue the same sequence
     uint8_t selection = 0;
+    uint8_t version = 0;
 };
 
 #endif
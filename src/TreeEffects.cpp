@@ -1,5 +1,7 @@
 #include "TreeEffects.h"
 
+#include <atomic>
+#include <new>
 #include <stdint.h>
 
 #include "TreeLight.h"
@@ -40,36 +42,49 @@ namespace
 // rainbow
 // running light
 
-class OffEffect : public IEffect
+/// Base of all effects, effects hide these functions and constants if they need them
+///
+/// A frame may only depend on the effect time and the colors, not on earlier frames. Then the effect can be rendered
+/// at any time, frames can be skipped and the period cache and keyframes work for every effect.
+class Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    void reset(bool timerOnly) { }
+
+    /// Effect time after which the effect repeats, 0 if it does not. Effects with a period are cached, so run has to
+    /// return the default EffectControl.
+    static constexpr unsigned long period = 0;
+    /// Frames per evaluation of the effect, the frames between are interpolated linearly. Only for effects which
+    /// change slowly compared to the frame rate.
+    static constexpr uint8_t keyframeInterval = 1;
+};
+
+class OffEffect : public Effect
+{
+public:
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
         leds.fill_solid(CRGB::Black);
         return {};
     }
-
-    const char* getName() const override { return "off"; }
 };
 
-class SolidEffect : public IEffect
+class SolidEffect : public Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
         leds.fill_solid(lights.firstColor());
         EffectControl result;
         result.allowAutoColorChange = true;
         return result;
     }
-
-    const char* getName() const override { return "solid"; }
 };
 
-class HorizontalRainbowEffect : public IEffect
+class HorizontalRainbowEffect : public Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
         if (!lights.isColorPalette())
         {
@@ -98,16 +113,16 @@ public:
         return {};
     }
 
-    const char* getName() const override { return "rainbowHorizontal"; }
+    static constexpr unsigned long period = 256 << 5;
 
 private:
-    uint8_t rainbowDeltaHue = 32;
+    static constexpr uint8_t rainbowDeltaHue = 32;
 };
 
-class VerticalRainbowEffect : public IEffect
+class VerticalRainbowEffect : public Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
         CRGB colors[3];
         uint8_t hue = (uint8_t)(effectTime >> 5); // effectTime / 32 => full rainbow in ~4s
@@ -131,76 +146,67 @@ public:
         return {};
     }
 
-    const char* getName() const override { return "rainbowVertical"; }
+    static constexpr unsigned long period = 256 << 5;
 
 private:
-    uint8_t rainbowDeltaHue = 32;
+    static constexpr uint8_t rainbowDeltaHue = 32;
 };
 
-class HorizontalGradientEffect : public IEffect
+class HorizontalGradientEffect : public Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
-        EffectControl result;
-        fract16 blendVal = (uint16_t)(effectTime >> 5); // effectTime / 32 => full gradient in ~4s
-        if (blendVal >= 512)
-        {
-            // Full gradient complete, transition to next color
-            lights.updateColor();
-            lights.resetEffect();
-            result.fadeOver = false; // do not want to fade here, still same effect
-            blendVal = 0;
-        }
+        // Full gradient in colorPeriod, then the next color of the sequence
+        const uint32_t step = effectTime / colorPeriod;
+        const fract16 blendVal = (uint16_t)((effectTime % colorPeriod) >> 5);
+        const CRGB first = lights.getSequenceColor(step);
+        const CRGB second = lights.getSequenceColor(step + 1);
         uint8_t blendStart = max((int)blendVal - 256, 0);
         uint8_t blendEnd = min((int)blendVal, 255);
-        CRGB cStart = blend(lights.firstColor(), lights.secondColor(), blendStart);
-        CRGB cMiddle = blend(lights.firstColor(), lights.secondColor(), ((int)blendStart + blendEnd) / 2);
-        CRGB cEnd = blend(lights.firstColor(), lights.secondColor(), blendEnd);
+        CRGB cStart = blend(first, second, blendStart);
+        CRGB cEnd = blend(first, second, blendEnd);
         leds(0, 7).fill_gradient_RGB(cStart, cEnd);
         leds(8, 11).fill_gradient_RGB(cStart, cEnd);
         leds[12] = leds[0];
 
-        return result;
+        return {};
     }
 
-    const char* getName() const override { return "gradientHorizontal"; }
+private:
+    static constexpr unsigned long colorPeriod = 512 << 5; // effectTime / 32 => full gradient in ~16s
 };
 
-class VerticalGradientEffect : public IEffect
+class VerticalGradientEffect : public Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
-        EffectControl result;
-        fract16 blendVal = (uint16_t)(effectTime >> 5); // effectTime / 32 => full gradient in ~4s
-        if (blendVal >= 512)
-        {
-            // Full gradient complete, transition to next color
-            lights.updateColor();
-            lights.resetEffect();
-            result.fadeOver = false; // do not want to fade here, still same effect
-            blendVal = 0;
-        }
+        // Full gradient in colorPeriod, then the next color of the sequence
+        const uint32_t step = effectTime / colorPeriod;
+        const fract16 blendVal = (uint16_t)((effectTime % colorPeriod) >> 5);
+        const CRGB first = lights.getSequenceColor(step);
+        const CRGB second = lights.getSequenceColor(step + 1);
         uint8_t blendStart = max((int)blendVal - 256, 0);
         uint8_t blendEnd = min((int)blendVal, 255);
-        CRGB cStart = blend(lights.firstColor(), lights.secondColor(), blendStart);
-        CRGB cMiddle = blend(lights.firstColor(), lights.secondColor(), ((int)blendStart + blendEnd) / 2);
-        CRGB cEnd = blend(lights.firstColor(), lights.secondColor(), blendEnd);
+        CRGB cStart = blend(first, second, blendStart);
+        CRGB cMiddle = blend(first, second, ((int)blendStart + blendEnd) / 2);
+        CRGB cEnd = blend(first, second, blendEnd);
         leds(0, 7).fill_solid(cStart);
         leds(8, 11).fill_solid(cMiddle);
         leds[12] = cEnd;
 
-        return result;
+        return {};
     }
 
-    const char* getName() const override { return "gradientVertical"; }
+private:
+    static constexpr unsigned long colorPeriod = 512 << 5; // effectTime / 32 => full gradient in ~16s
 };
 
-class TwinkleFoxEffect : public IEffect
+class TwinkleFoxEffect : public Effect
 {
 public:
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
         // From FastLED TwinkleFox example by Mark Kriegsman
         uint16_t prng16 = 11337;
@@ -241,6 +247,9 @@ public:
         result.allowAutoColorChange = true;
         return result;
     }
+    // Twinkles have smooth envelopes, so linear interpolation is close to the full rate
+    static constexpr uint8_t keyframeInterval = 4;
+
     CRGB computeTwinkle(TreeLightView& lights, uint32_t clock, uint8_t salt)
     {
         // From FastLED TwinkleFox example by Mark Kriegsman
@@ -272,7 +281,6 @@ public:
         return c;
     }
 
-    const char* getName() const override { return "twinkleFox"; }
 
 private:
     uint8_t twinkleSpeed = 4; // 0-8
@@ -281,32 +289,20 @@ private:
     CRGB bg = CRGB::Black; // Background color
 };
 
-class TwoColorChangeEffect : public IEffect
+class TwoColorChangeEffect : public Effect
 {
 public:
-    void reset(bool timerOnly)
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
-        colorChangeTime = 0;
-        swapped = false;
-    }
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
-    {
-        unsigned long dt = effectTime - colorChangeTime;
-        uint16_t fadeTime = 1 << (fadeDuration + 8);
-        CRGB first = getColor(lights, false);
-        CRGB second = getColor(lights, true);
+        // Colors swap every swapTime since the start of the effect
+        const bool swapped = (effectTime / swapTime) & 1;
+        const unsigned long dt = effectTime % swapTime;
+        const uint16_t fadeTime = 1 << (fadeDuration + 8);
+        const CRGB first = swapped ? lights.secondColor() : lights.firstColor();
+        const CRGB second = swapped ? lights.firstColor() : lights.secondColor();
         CRGB c1;
         CRGB c2;
-        if (dt >= swapTime)
-        {
-            // swap
-            swapped = !swapped;
-            colorChangeTime += swapTime;
-
-            c1 = second;
-            c2 = first;
-        }
-        else if (dt >= swapTime - fadeTime)
+        if (dt >= swapTime - fadeTime)
         {
             // fade
             fract8 fade = (dt - (swapTime - fadeTime)) >> 1;
@@ -335,37 +331,24 @@ public:
         return result;
     }
 
-    CRGB getColor(TreeLightView& lights, bool second)
-    {
-        return (swapped == second) ? lights.firstColor() : lights.secondColor();
-    }
-
-    const char* getName() const override { return "twoColorChange"; }
-
 private:
-    unsigned long colorChangeTime = 0;
-    uint16_t swapTime = 2000;
-    uint8_t fadeDuration = 1; // 1<<(fadeSpeed+8) must be less than swapTime
-    bool swapped = false;
+    static constexpr uint16_t swapTime = 2000;
+    static constexpr uint8_t fadeDuration = 1; // 1<<(fadeSpeed+8) must be less than swapTime
 };
 
-class RunningLightEffect : public IEffect
+class RunningLightEffect : public Effect
 {
 public:
-    void reset(bool timerOnly) { colorChangeTime = 0; }
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
         EffectControl result;
         uint8_t numLeds = leds.size();
         const uint8_t lightCount = 4; // max number of lit leds
-        uint8_t nLights = (uint8_t)(effectTime - colorChangeTime >> 9); // effectTime / 512 => about 4 leds per second
-        uint16_t fade = (uint16_t)(effectTime - colorChangeTime >> 0) & 0x1FF;
+        // Runs repeat from the start of the effect
+        const unsigned long runTime = effectTime % ((unsigned long)(numLeds + lightCount) << 9);
+        uint8_t nLights = (uint8_t)(runTime >> 9); // effectTime / 512 => about 4 leds per second
+        uint16_t fade = (uint16_t)runTime & 0x1FF;
         leds.fill_solid(CRGB::Black);
-        if (nLights >= numLeds + lightCount)
-        {
-            nLights = 0;
-            colorChangeTime += (unsigned long)(numLeds + lightCount) << 9;
-        }
         if (nLights > 0)
         {
             int end = min((int)numLeds - nLights + lightCount - 1, (int)numLeds);
@@ -409,144 +392,382 @@ public:
         }
         return result;
     }
-    const char* getName() const override { return "runningLight"; }
-
-private:
-    unsigned long colorChangeTime = 0;
 };
 
-template <uint8_t N>
-class CyclingEffect : public IEffect
+class CyclingEffect;
+
+namespace
 {
-public:
-    CyclingEffect<N>()
+    constexpr size_t maxOf(size_t a, size_t b) { return a > b ? a : b; }
+    constexpr size_t maxOf(const size_t* values, size_t n)
     {
-        for (uint8_t i = 0; i < N; ++i)
-        {
-            effectList[i] = nullptr;
-            effectCycles[i] = 1;
-        }
+        return n == 0 ? 0 : maxOf(values[0], maxOf(values + 1, n - 1));
     }
+    constexpr size_t sumOf(const size_t* values, size_t n) { return n == 0 ? 0 : values[0] + sumOf(values + 1, n - 1); }
 
-    void setEffect(uint8_t idx, IEffect* e)
+    ///@brief Construct, destroy and call an effect in raw storage, does nothing if the effect is not available
+    template <typename T, bool available>
+    struct EffectOps
     {
-        if (idx < N)
+        static constexpr size_t size = sizeof(T);
+        static constexpr size_t align = alignof(T);
+        static constexpr unsigned long period = T::period;
+        static constexpr uint8_t keyframeInterval = T::keyframeInterval;
+        static void create(void* p) { new (p) T(); }
+        static void destroy(void* p) { static_cast<T*>(p)->~T(); }
+        static EffectControl run(void* p, TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
         {
-            effectList[idx] = e;
+            return static_cast<T*>(p)->run(lights, leds, effectTime);
         }
+        static void reset(void* p, bool timerOnly) { static_cast<T*>(p)->reset(timerOnly); }
+    };
+    // Never references T, so disabled effects are not compiled in and T can be incomplete
+    template <typename T>
+    struct EffectOps<T, false>
+    {
+        static constexpr size_t size = 0;
+        static constexpr size_t align = 1;
+        static constexpr unsigned long period = 0;
+        static constexpr uint8_t keyframeInterval = 1;
+        static void create(void*) { }
+        static void destroy(void*) { }
+        static EffectControl run(void*, TreeLightView&, CRGBSet&, unsigned long) { return {}; }
+        static void reset(void*, bool) { }
+    };
+
+    ///@brief Effect is compiled in and can be held, cycling cannot contain itself
+    constexpr bool isAvailable(EffectType type, bool nested)
+    {
+        return TreeEffects::isEnabled(type) && !(nested && type == EffectType::cycling);
     }
-    void setEffects(IEffect* const* effects, uint8_t num, uint8_t start = 0)
+
+    ///@brief Storage for one effect, which is constructed when it is selected
+    ///@tparam nested Holder inside the cycling effect
+    template <bool nested>
+    class EffectHolder
     {
-        uint8_t max = start + num;
-        if (max > N)
+    public:
+        static constexpr size_t sizes[] = {
+#define TREE_EFFECT_SIZE(type, Class, enabled) EffectOps<Class, isAvailable(EffectType::type, nested)>::size,
+            TREE_EFFECT_LIST(TREE_EFFECT_SIZE)
+#undef TREE_EFFECT_SIZE
+        };
+        static constexpr size_t aligns[] = {
+#define TREE_EFFECT_ALIGN(type, Class, enabled) EffectOps<Class, isAvailable(EffectType::type, nested)>::align,
+            TREE_EFFECT_LIST(TREE_EFFECT_ALIGN)
+#undef TREE_EFFECT_ALIGN
+        };
+        static constexpr size_t storageSize = maxOf(sizes, (size_t)EffectType::maxValue);
+        static constexpr size_t storageAlign = maxOf(aligns, (size_t)EffectType::maxValue);
+
+        EffectHolder() = default;
+        EffectHolder(const EffectHolder&) = delete;
+        EffectHolder& operator=(const EffectHolder&) = delete;
+        ~EffectHolder() { destroy(); }
+
+        ///@brief Construct a new effect, the previous effect is destroyed
+        void create(EffectType newType)
         {
-            max = N;
+            destroy();
+            if (!isAvailable(newType, nested))
+            {
+                return;
+            }
+            switch (newType)
+            {
+#define TREE_EFFECT_CREATE(type, Class, enabled)                                                                       \
+    case EffectType::type:                                                                                             \
+        EffectOps<Class, isAvailable(EffectType::type, nested)>::create(storage);                                      \
+        break;
+                TREE_EFFECT_LIST(TREE_EFFECT_CREATE)
+#undef TREE_EFFECT_CREATE
+            default:
+                return;
+            }
+            type = newType;
         }
-        for (uint8_t i = start; i < max; ++i)
+        void destroy()
         {
-            effectList[i] = *effects;
-            ++effects;
+            switch (type)
+            {
+#define TREE_EFFECT_DESTROY(type, Class, enabled)                                                                      \
+    case EffectType::type:                                                                                             \
+        EffectOps<Class, isAvailable(EffectType::type, nested)>::destroy(storage);                                     \
+        break;
+                TREE_EFFECT_LIST(TREE_EFFECT_DESTROY)
+#undef TREE_EFFECT_DESTROY
+            default:
+                break;
+            }
+            type = EffectType::maxValue;
         }
-    }
-    void setEffectCycles(uint8_t idx, uint8_t numCycles)
+        ///@brief Effect type or EffectType::maxValue when empty
+        EffectType getType() const { return type; }
+
+        EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
+        {
+            switch (type)
+            {
+#define TREE_EFFECT_RUN(type, Class, enabled)                                                                          \
+    case EffectType::type:                                                                                             \
+        return EffectOps<Class, isAvailable(EffectType::type, nested)>::run(storage, lights, leds, effectTime);
+                TREE_EFFECT_LIST(TREE_EFFECT_RUN)
+#undef TREE_EFFECT_RUN
+            default:
+                return {};
+            }
+        }
+        ///@brief timerOnly is true when effectTime was reset, a full reset constructs the effect again
+        void reset(bool timerOnly)
+        {
+            if (!timerOnly)
+            {
+                create(type);
+                return;
+            }
+            switch (type)
+            {
+#define TREE_EFFECT_RESET(type, Class, enabled)                                                                        \
+    case EffectType::type:                                                                                             \
+        EffectOps<Class, isAvailable(EffectType::type, nested)>::reset(storage, true);                                 \
+        break;
+                TREE_EFFECT_LIST(TREE_EFFECT_RESET)
+#undef TREE_EFFECT_RESET
+            default:
+                break;
+            }
+        }
+
+    private:
+        alignas(storageAlign) uint8_t storage[storageSize > 0 ? storageSize : 1];
+        EffectType type = EffectType::maxValue;
+    };
+    template <bool nested>
+    constexpr size_t EffectHolder<nested>::sizes[];
+    template <bool nested>
+    constexpr size_t EffectHolder<nested>::aligns[];
+} // namespace
+
+class CyclingEffect : public Effect
+{
+public:
+    EffectControl run(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
     {
-        if (idx < N)
+        // Every effect is shown for cycleTime with the next colors of the sequence
+        const uint32_t cycle = effectTime / cycleTime;
+        const unsigned long time = effectTime % cycleTime;
+        render(current, cycle, lights, leds, time);
+        if (cycle > 0 && time < fadeTime)
         {
-            effectCycles[idx] = numCycles;
+            // Fade over from the previous effect, which continues to run
+            CRGB previousPixels[TreeLight::numLeds];
+            CRGBSet previousLeds(previousPixels, leds.size());
+            render(previous, cycle - 1, lights, previousLeds, time + cycleTime);
+            const uint8_t amount = time * 255 / fadeTime;
+            for (uint8_t i = 0; i < leds.size(); ++i)
+            {
+                leds[i] = blend(previousLeds[i], leds[i], amount);
+            }
         }
+        // The cycle changes the colors itself
+        return {};
     }
 
-    void reset(bool timerOnly) override
+private:
+    ///@brief Render the effect of the cycle, the holder only constructs it when the effect changes
+    static void render(
+        EffectHolder<true>& holder, uint32_t cycle, TreeLightView& lights, CRGBSet& leds, unsigned long time)
     {
-        if (timerOnly)
+        const EffectType type = getEffect(cycle);
+        if (type != holder.getType())
         {
-            // this is called after every color change, so do not reset but update the effect
-            ++effectColors;
-            if (effectColors >= effectCycles[effectIdx])
+            holder.create(type);
+        }
+        TreeLightView view = lights.withColorStep(cycle);
+        holder.run(view, leds, time);
+    }
+    ///@brief All enabled effects except off and cycling are shown in order
+    static bool isCycled(EffectType e) { return e != EffectType::off && isAvailable(e, true); }
+    ///@brief Effect which is shown in the cycle. Solid is always enabled.
+    static EffectType getEffect(uint32_t cycle)
+    {
+        uint8_t total = 0;
+        for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue; ++i)
+        {
+            if (isCycled((EffectType)i))
             {
-                nextEffect();
+                ++total;
             }
-            else
+        }
+        uint8_t position = cycle % total;
+        for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue; ++i)
+        {
+            const EffectType e = (EffectType)i;
+            if (isCycled(e))
             {
-                IEffect* e = effectList[effectIdx];
-                if (e)
+                if (position == 0)
                 {
-                    e->reset(true);
+                    return e;
                 }
+                --position;
             }
         }
-        else
+        return EffectType::solid;
+    }
+
+private:
+    // Long enough for about four colors of the gradients
+    static constexpr unsigned long cycleTime = 60000;
+    static constexpr unsigned long fadeTime = 1000;
+
+    EffectHolder<true> current; // Constructed when the shown effect changes
+    EffectHolder<true> previous; // Effect of the last cycle while fading over from it
+};
+
+namespace
+{
+    using OuterHolder = EffectHolder<false>;
+
+    // Arena for the current and the outgoing effect and the segments
+    OuterHolder slots[TreeEffects::numSlots];
+    // Only used by off-screen renders, which can run in another task on ESP32
+    OuterHolder offscreenHolder;
+    std::atomic_flag offscreenBusy = ATOMIC_FLAG_INIT;
+
+    // Names are only stored for enabled effects. The flag is expanded before it is pasted, so it has to be 0 or 1.
+#define TREE_EFFECT_NAME_0(type)
+#define TREE_EFFECT_NAME_1(type) const char type##Name[] PROGMEM = #type;
+#define TREE_EFFECT_NAME_PTR_0(type) nullptr,
+#define TREE_EFFECT_NAME_PTR_1(type) type##Name,
+#define TREE_EFFECT_SELECT(macro, type, enabled) macro##enabled(type)
+#define TREE_EFFECT_NAME(type, Class, enabled) TREE_EFFECT_SELECT(TREE_EFFECT_NAME_, type, enabled)
+    TREE_EFFECT_LIST(TREE_EFFECT_NAME)
+#undef TREE_EFFECT_NAME
+
+    const char* const effectNames[] PROGMEM = {
+#define TREE_EFFECT_NAME_PTR(type, Class, enabled) TREE_EFFECT_SELECT(TREE_EFFECT_NAME_PTR_, type, enabled)
+        TREE_EFFECT_LIST(TREE_EFFECT_NAME_PTR)
+#undef TREE_EFFECT_NAME_PTR
+    };
+#undef TREE_EFFECT_SELECT
+#undef TREE_EFFECT_NAME_PTR_1
+#undef TREE_EFFECT_NAME_PTR_0
+#undef TREE_EFFECT_NAME_1
+#undef TREE_EFFECT_NAME_0
+} // namespace
+
+namespace TreeEffects
+{
+    void create(uint8_t slot, EffectType type)
+    {
+        if (slot < numSlots)
         {
-            effectIdx = 0;
-            effectColors = 0;
-            IEffect* e = effectList[effectIdx];
-            if (e)
-            {
-                e->reset(false);
-            }
+            slots[slot].create(type);
         }
     }
-    void nextEffect()
+
+    void destroy(uint8_t slot)
     {
-        effectColors = 0;
-        ++effectIdx;
-        if (effectIdx >= N)
+        if (slot < numSlots)
         {
-            effectIdx = 0;
+            slots[slot].destroy();
         }
-        IEffect* e = effectList[effectIdx];
-        if (e)
+    }
+
+    EffectType getType(uint8_t slot)
+    {
+        return slot < numSlots ? slots[slot].getType() : EffectType::maxValue;
+    }
+
+    EffectControl run(uint8_t slot, TreeLightView& lights, CRGBSet& leds, unsigned long effectTime)
+    {
+        if (slot < numSlots)
         {
-            e->reset(false);
+            return slots[slot].run(lights, leds, effectTime);
         }
+        return {};
     }
 
-    EffectControl runEffect(TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) override
+    void reset(uint8_t slot, bool timerOnly)
     {
-        IEffect* e = effectList[effectIdx];
-        EffectControl result;
-        if (e)
+        if (slot < numSlots)
         {
-            result = e->runEffect(lights, leds, effectTime);
-            if (effectTime >= maxEffectTime)
-            {
-                // Effects that do not cycle by themselves
-                lights.resetEffect(true);
-            }
+            slots[slot].reset(timerOnly);
         }
-        else
+    }
+
+    bool lockOffscreen()
+    {
+        return !offscreenBusy.test_and_set();
+    }
+
+    void unlockOffscreen()
+    {
+        offscreenBusy.clear();
+    }
+
+    bool renderOffscreen(EffectType type, const TreeColors& colors, unsigned long start, unsigned long step,
+        CRGB* frames, uint16_t numFrames)
+    {
+        if (!isEnabled(type))
         {
-            nextEffect();
+            return false;
         }
-        return result;
+        TreeLightView view(colors);
+        offscreenHolder.create(type);
+        for (uint16_t i = 0; i < numFrames; ++i)
+        {
+            CRGBSet leds(frames + i * TreeLight::numLeds, TreeLight::numLeds);
+            offscreenHolder.run(view, leds, start + step * i);
+        }
+        offscreenHolder.destroy();
+        return true;
     }
 
-    const char* getName() const override { return "cycling"; }
+    unsigned long getPeriod(EffectType type)
+    {
+        switch (type)
+        {
+#define TREE_EFFECT_PERIOD(type, Class, enabled)                                                                       \
+    case EffectType::type:                                                                                             \
+        return EffectOps<Class, isAvailable(EffectType::type, false)>::period;
+            TREE_EFFECT_LIST(TREE_EFFECT_PERIOD)
+#undef TREE_EFFECT_PERIOD
+        default:
+            return 0;
+        }
+    }
 
-private:
-    IEffect* effectList[N];
-    unsigned long maxEffectTime = 60000;
-    uint8_t effectCycles[N];
-    uint8_t effectColors = 0;
-    uint8_t effectIdx = 0;
-};
+    uint8_t getKeyframeInterval(EffectType type)
+    {
+        switch (type)
+        {
+#define TREE_EFFECT_KEYFRAMES(type, Class, enabled)                                                                    \
+    case EffectType::type:                                                                                             \
+        return EffectOps<Class, isAvailable(EffectType::type, false)>::keyframeInterval;
+            TREE_EFFECT_LIST(TREE_EFFECT_KEYFRAMES)
+#undef TREE_EFFECT_KEYFRAMES
+        default:
+            return 1;
+        }
+    }
 
-IEffect** createEffects()
-{
-    static OffEffect off;
-    static SolidEffect solid;
-    static TwoColorChangeEffect twoColor;
-    static HorizontalGradientEffect gradientHorizontal;
-    static VerticalGradientEffect gradientVertical;
-    static HorizontalRainbowEffect rainbowHorizontal;
-    static VerticalRainbowEffect rainbowVertical;
-    static RunningLightEffect runningLight;
-    static TwinkleFoxEffect twinkleFox;
-    static CyclingEffect<(uint8_t)EffectType::maxValue - 2> cycling;
-    static IEffect* e[(int)EffectType::maxValue] = {&off, &solid, &twoColor, &gradientHorizontal, &gradientVertical,
-        &rainbowHorizontal, &rainbowVertical, &runningLight, &twinkleFox, &cycling};
-    cycling.setEffects(e + 1, (uint8_t)EffectType::maxValue - 2);
-    cycling.setEffectCycles((uint8_t)EffectType::gradientHorizontal - 1, 4);
-    cycling.setEffectCycles((uint8_t)EffectType::gradientVertical - 1, 4);
-    return e;
-}
+    const __FlashStringHelper* getName(EffectType type)
+    {
+        if (type < EffectType::maxValue)
+        {
+            return (const __FlashStringHelper*)pgm_read_ptr(&effectNames[(int)type]);
+        }
+        return nullptr;
+    }
+
+    size_t getArenaSize()
+    {
+        return sizeof(slots) + sizeof(offscreenHolder);
+    }
+
+    size_t getStaticSize()
+    {
+        return sumOf(OuterHolder::sizes, (size_t)EffectType::maxValue);
+    }
+} // namespace TreeEffects
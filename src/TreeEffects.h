@@ -1,42 +1,123 @@
 #ifndef TREE_EFFECTS_H
 #define TREE_EFFECTS_H
 
+#include <Arduino.h>
 #include <FastLED.h>
 
-// These effect types have to match the order in createEffects() in the cpp file
-enum class EffectType
+// Build flags to leave out effects, e.g. -DEFFECT_TWINKLEFOX=0. The value has to be 0 or 1.
+#ifndef EFFECT_TWO_COLOR_CHANGE
+#define EFFECT_TWO_COLOR_CHANGE 1
+#endif
+#ifndef EFFECT_GRADIENT
+#define EFFECT_GRADIENT 1
+#endif
+#ifndef EFFECT_RAINBOW
+#define EFFECT_RAINBOW 1
+#endif
+#ifndef EFFECT_RUNNING_LIGHT
+#define EFFECT_RUNNING_LIGHT 1
+#endif
+#ifndef EFFECT_TWINKLEFOX
+#define EFFECT_TWINKLEFOX 1
+#endif
+#ifndef EFFECT_CYCLING
+#define EFFECT_CYCLING 1
+#endif
+
+/// Registry of all effects: X(type, class, enabled)
+///
+/// The position is the effect number in the config, web ui and mqtt, so new effects are only appended.
+/// Disabled effects keep their number, but are not compiled in and cannot be selected.
+#define TREE_EFFECT_LIST(X)                                                                                            \
+    X(off, OffEffect, 1)                                                                                               \
+    X(solid, SolidEffect, 1)                                                                                           \
+    X(twoColorChange, TwoColorChangeEffect, EFFECT_TWO_COLOR_CHANGE)                                                   \
+    X(gradientHorizontal, HorizontalGradientEffect, EFFECT_GRADIENT)                                                   \
+    X(gradientVertical, VerticalGradientEffect, EFFECT_GRADIENT)                                                       \
+    X(rainbowHorizontal, HorizontalRainbowEffect, EFFECT_RAINBOW)                                                      \
+    X(rainbowVertical, VerticalRainbowEffect, EFFECT_RAINBOW)                                                          \
+    X(runningLight, RunningLightEffect, EFFECT_RUNNING_LIGHT)                                                          \
+    X(twinkleFox, TwinkleFoxEffect, EFFECT_TWINKLEFOX)                                                                 \
+    X(cycling, CyclingEffect, EFFECT_CYCLING)
+
+enum class EffectType : uint8_t
 {
-    off,
-    solid,
-    twoColorChange,
-    gradientHorizontal,
-    gradientVertical,
-    rainbowHorizontal,
-    rainbowVertical,
-    runningLight,
-    twinkleFox,
-    cycling,
+#define TREE_EFFECT_TYPE(type, Class, enabled) type,
+    TREE_EFFECT_LIST(TREE_EFFECT_TYPE)
+#undef TREE_EFFECT_TYPE
     maxValue // Not an effect, number of valid effects
 };
 
-class IEffect
+struct EffectControl
 {
-public:
-    struct EffectControl
-    {
-        bool allowAutoColorChange = false; // Color can change after this effect pass
-        bool fadeOver = true; // Fade over from color of last effect to current effect color
+    bool allowAutoColorChange = false; // Color can change after this effect pass
+    bool fadeOver = true; // Fade over from color of last effect to current effect color
+};
+
+class TreeColors;
+class TreeLightView;
+
+/// Effects are plain classes without virtual functions. These functions dispatch with a switch over the type,
+/// so the compiler can inline the effects and fold their constants.
+///
+/// Effects are constructed on demand in a fixed arena with one slot per effect that can exist at the same time.
+namespace TreeEffects
+{
+    constexpr bool enabledEffects[] = {
+#define TREE_EFFECT_ENABLED(type, Class, enabled) (enabled) != 0,
+        TREE_EFFECT_LIST(TREE_EFFECT_ENABLED)
+#undef TREE_EFFECT_ENABLED
     };
 
-public:
-    virtual ~IEffect() = default;
+    ///@brief Effect is valid and compiled in
+    constexpr bool isEnabled(EffectType type)
+    {
+        return type < EffectType::maxValue && enabledEffects[(int)type];
+    }
+
+    ///@brief Number of segments, which have their own effect
+    constexpr uint8_t maxSegments = 3;
+    ///@brief Slots 0 and 1 hold the current and the outgoing effect of a transition, followed by one per segment
+    constexpr uint8_t numSlots = 2 + maxSegments;
+    constexpr uint8_t firstSegmentSlot = 2;
 
-    virtual void reset(bool timerOnly) {}; // timerOnly is true when effectTime was reset, false for a full effect reset
-    virtual EffectControl runEffect(class TreeLightView& lights, CRGBSet& leds, unsigned long effectTime) = 0;
-    virtual const char* getName() const = 0;
-};
+    ///@brief Construct an effect in the slot, the previous effect in it is destroyed
+    void create(uint8_t slot, EffectType type);
+    void destroy(uint8_t slot);
+    ///@brief Type of the effect in the slot, EffectType::maxValue if it is empty
+    EffectType getType(uint8_t slot);
+    ///@brief Render a frame of the effect in the slot
+    EffectControl run(uint8_t slot, TreeLightView& lights, CRGBSet& leds, unsigned long effectTime);
+    ///@brief timerOnly is true when effectTime was reset, a full reset constructs the effect again
+    void reset(uint8_t slot, bool timerOnly);
+    ///@brief Reserve the off-screen renderer, which can be used from another task than the tree
+    ///
+    /// Callers may guard their own buffers for the frames with it, until @ref unlockOffscreen.
+    ///@returns false if another off-screen render is running
+    bool lockOffscreen();
+    void unlockOffscreen();
+    ///@brief Render frames of an effect off-screen, without changing the tree or the live effects
+    ///
+    /// Uses its own storage for the effect, so it can be called while the tree is running.
+    /// The renderer has to be reserved with @ref lockOffscreen.
+    ///@param colors Colors of the effect
+    ///@param start Effect time of the first frame
+    ///@param step Effect time between frames
+    ///@param frames Buffer for numFrames frames of TreeLight::numLeds pixels each
+    ///@returns false if the effect is not enabled
+    bool renderOffscreen(EffectType type, const TreeColors& colors, unsigned long start, unsigned long step,
+        CRGB* frames, uint16_t numFrames);
+    ///@brief Effect time after which the effect repeats, 0 if it does not repeat and cannot be cached
+    unsigned long getPeriod(EffectType type);
+    ///@brief Frames per evaluation of the effect, 1 if it is rendered every frame
+    uint8_t getKeyframeInterval(EffectType type);
+    ///@brief Name in flash, nullptr if the effect is not enabled
+    const __FlashStringHelper* getName(EffectType type);
 
-// Returns array with EffectType::maxValue elements
-IEffect** createEffects();
+    ///@brief Bytes of RAM used by the effect arena
+    size_t getArenaSize();
+    ///@brief Bytes of RAM all enabled effects would use if they were allocated statically
+    size_t getStaticSize();
+} // namespace TreeEffects
 
 #endif
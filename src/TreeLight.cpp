@@ -1,44 +1,99 @@
 #include "TreeLight.h"
 
+#include "Constants.h"
+
 #ifdef ESP32
 #include <bootloader_random.h>
 #endif
 
+namespace
+{
+    const CRGB ledCorrection = LEDColorCorrection::Typical8mmPixel;
+
+#if defined(ESP32)
+    // The web server runs in another task, which can run on the other core
+    portMUX_TYPE colorSnapshotLock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+    void lockColorSnapshot()
+    {
+#if defined(ESP32)
+        portENTER_CRITICAL(&colorSnapshotLock);
+#elif defined(ESP8266)
+        noInterrupts();
+#endif
+    }
+
+    void unlockColorSnapshot()
+    {
+#if defined(ESP32)
+        portEXIT_CRITICAL(&colorSnapshotLock);
+#elif defined(ESP8266)
+        interrupts();
+#endif
+    }
+} // namespace
+
 void TreeLight::init(Menu& menu)
 {
     this->menu = &menu;
 
     // Init random seed
-#if defined(ESP32)
+#if RANDOM_SEED != 0
+    const uint32_t seed = RANDOM_SEED;
+#elif defined(ESP32)
     // Has to be called before using wifi, ADC or I2S, otherwise remove bootloader_random_enable
     // FastLED may use I2S, so initialize seed before that
     bootloader_random_enable();
-    randomSeed(esp_random());
+    const uint32_t seed = esp_random();
     bootloader_random_disable();
 #elif defined(ESP8266)
-    randomSeed(RANDOM_REG32);
+    const uint32_t seed = RANDOM_REG32;
 #else
-    randomSeed(analogRead(A0) * 17 + 23);
+    const uint32_t seed = analogRead(A0) * 17 + 23;
 #endif
+    randomSeed(seed);
+    colors.seed(seed);
+    for (uint8_t i = 0; i < TreeEffects::maxSegments; ++i)
+    {
+        // Different colors in every segment
+        segments[i].colors.seed(seed ^ (0x9E3779B9u * (i + 1)));
+    }
 
-    effectList = createEffects();
-    currentEffect = effectList[0];
-    currentEffect->reset(false);
+    TreeEffects::create(effectSlot, currentEffectType);
+    DEBUGF("Effect arena: %u bytes, static effects: %u bytes\n", (unsigned)TreeEffects::getArenaSize(),
+        (unsigned)TreeEffects::getStaticSize());
 #if defined(ESP32) || defined(ESP8266)
-    FastLED.addLeds<APA106, pin, RGB>(leds, numLeds);
+    FastLED.addLeds<APA106, pin, RGB>(output, numLeds);
 #else
-    FastLED.addLeds<WS2812, pin, GRB>(leds, numLeds);
+    FastLED.addLeds<WS2812, pin, GRB>(output, numLeds);
 #endif
 
+    // Brightness and correction are applied by the output lut
+    FastLED.setBrightness(255);
+    FastLED.setDither(DISABLE_DITHER);
+    outputLut.setCorrection(ledCorrection);
     setBrightnessLevel(4);
-    FastLED.setCorrection(LEDColorCorrection::Typical8mmPixel);
     leds.fill_solid(CRGB::Black);
+    frame.fill_solid(CRGB::Black);
+    writeOutput();
     FastLED.show();
     lastUpdate = millis();
     ledBackup.fill_solid(CRGB::Black);
 
+    // Menu and notifications are shown over a darkened effect
+    backdropLayer = layers.addLayer(CRGB(backdropLevel, backdropLevel, backdropLevel), BlendMode::multiply);
+    overlayLayer = layers.addLayer(overlay, BlendMode::normal);
+    menuLayer = layers.addLayer(menuPixels, BlendMode::normal);
+
     colors.initRandomColors();
     colors.setSelection(0);
+    for (Segment& s : segments)
+    {
+        s.colors.initRandomColors();
+        s.colors.setSelection(s.config.colorSelection);
+    }
+    publishColors();
 }
 
 void TreeLight::getStatusJsonString(JsonObject& output)
@@ -47,37 +102,136 @@ void TreeLight::getStatusJsonString(JsonObject& output)
     lights["brightness"] = getBrightnessLevel();
     lights["speed"] = getSpeed();
     lights["effect"] = (int)getEffectType();
+    lights["effect_time"] = effectTime;
+    lights["effect_ram"] = TreeEffects::getArenaSize();
+    lights["effect_ram_static"] = TreeEffects::getStaticSize();
+    lights["transition"] = (int)transitionType;
+    lights["render_us"] = renderTime;
+    lights["live_transitions"] = liveTransitions;
+    lights["snapshot_transitions"] = snapshotTransitions;
+    periodCache.getStatusJsonString(lights);
+    lights["morph_us"] = morphTime;
+    lights["interpolated_frames"] = interpolatedFrames;
+    lights["interpolation_saved_ms"] = (uint32_t)(interpolationSaved / 1000);
     JsonArray effects = lights.createNestedArray("effects");
     for (size_t i = 0; i < (size_t)EffectType::maxValue; ++i)
     {
-        effects.add(effectList[i]->getName());
+        // Disabled effects are null, so the index is still the effect number
+        const __FlashStringHelper* name = getEffectName((EffectType)i);
+        if (name != nullptr)
+        {
+            effects.add(name);
+        }
+        else
+        {
+            effects.add(nullptr);
+        }
     }
     lights["color"] = colors.getSelection();
+    lights["current_ma"] = estimatedCurrent;
+    lights["max_current_ma"] = maxCurrent;
+    lights["current_limit"] = currentLimit / 256.0f;
+    lights["dithering"] = dithering;
+    JsonArray segmentArray = lights.createNestedArray("segments");
+    for (const Segment& s : segments)
+    {
+        JsonObject segment = segmentArray.createNestedObject();
+        segment["enabled"] = s.config.enabled;
+        segment["start"] = s.config.start;
+        segment["end"] = s.config.end;
+        segment["effect"] = (int)s.config.effect;
+        segment["color"] = s.config.colorSelection;
+        segment["speed"] = s.config.speed;
+        segment["render_us"] = s.renderTime;
+    }
     // TODO: cache values that do not change, reserve array space for fixed size
     JsonArray colors = lights.createNestedArray("colors");
     for (uint8_t i = 0; i < TreeColors::getSelectionCount(); ++i)
     {
-        colors.add(TreeColors::getSelectionName(i));
+        if (TreeColors::isSelectionEnabled(i))
+        {
+            colors.add(TreeColors::getSelectionName(i));
+        }
+        else
+        {
+            colors.add(nullptr);
+        }
     }
 }
 
-void TreeLight::nextEffect()
+const __FlashStringHelper* TreeLight::getEffectName(EffectType e) const
 {
-    currentEffectType = (EffectType)((int)currentEffectType + 1);
-    if (currentEffectType >= EffectType::maxValue)
+    return TreeEffects::getName(e);
+}
+
+void TreeLight::applySettings(const JsonObjectConst& settings)
+{
+    if (settings["brightness"].is<uint8_t>())
+    {
+        const uint8_t level = settings["brightness"];
+        if (level >= 1 && level <= 8)
+        {
+            setBrightnessLevel(level);
+        }
+    }
+    if (settings["speed"].is<uint8_t>())
+    {
+        setSpeed(static_cast<Speed>(settings["speed"].as<uint8_t>()));
+    }
+    if (settings["effect"].is<uint8_t>())
+    {
+        setEffect(static_cast<EffectType>(settings["effect"].as<uint8_t>()));
+    }
+    if (settings["color"].is<uint8_t>())
+    {
+        const uint8_t color = settings["color"];
+        if (TreeColors::isSelectionEnabled(color))
+        {
+            setColorSelection(color);
+        }
+    }
+    if (settings["effect_time"].is<unsigned long>())
     {
-        currentEffectType = (EffectType)0;
+        seek(settings["effect_time"]);
     }
-    currentEffect = effectList[(int)currentEffectType];
+    if (settings["segments"].is<JsonArrayConst>())
+    {
+        // Missing values are kept, segments which are not in the array are disabled
+        JsonArrayConst segmentArray = settings["segments"];
+        for (uint8_t i = 0; i < TreeEffects::maxSegments; ++i)
+        {
+            SegmentConfig config = segments[i].config;
+            JsonObjectConst segment = segmentArray[i];
+            config.enabled = !segment.isNull() && (segment["enabled"] | true);
+            config.start = segment["start"] | config.start;
+            config.end = segment["end"] | config.end;
+            config.effect = static_cast<EffectType>(segment["effect"] | (uint8_t)config.effect);
+            config.colorSelection = segment["color"] | config.colorSelection;
+            config.speed = segment["speed"] | config.speed;
+            setSegment(i, config);
+        }
+    }
+}
+
+void TreeLight::nextEffect()
+{
+    // Skip effects which are not compiled in, off is always enabled
+    do
+    {
+        currentEffectType = (EffectType)((int)currentEffectType + 1);
+        if (currentEffectType >= EffectType::maxValue)
+        {
+            currentEffectType = (EffectType)0;
+        }
+    } while (!TreeEffects::isEnabled(currentEffectType));
     resetEffect(false);
 }
 
 void TreeLight::setEffect(EffectType e)
 {
-    if (e != currentEffectType && e < EffectType::maxValue)
+    if (e != currentEffectType && TreeEffects::isEnabled(e))
     {
         currentEffectType = e;
-        currentEffect = effectList[(int)e];
         resetEffect(false);
     }
 }
@@ -114,35 +268,158 @@ void TreeLight::setSpeed(Speed s)
 void TreeLight::update()
 {
     unsigned long t = millis();
-    if (t - lastUpdate < 10)
+    const bool outputStatic = isOutputStatic();
+    const uint32_t settings = getOutputSettings();
+    if (idle)
+    {
+        if (outputStatic && settings == idleSettings && segmentVersion == idleSegmentVersion)
+        {
+            // Nothing to show until the settings change
+            return;
+        }
+        idle = false;
+        // Do not count the idle time as effect time
+        lastUpdate = t - frameInterval;
+    }
+    // Called every update interval by the scheduler, whose clock can be up to 1 ms behind the one read here
+    if (t - lastUpdate + 1 < frameInterval)
     {
-        FastLED.show();
+        if (dithering && t - lastRefresh + 1 >= ditherInterval)
+        {
+            lastRefresh = t;
+            refreshOutput();
+            FastLED.show();
+        }
         return;
     }
-    if (menu->isActive())
+    // The effect keeps running under the menu and notifications
+    effectTime += (t - lastUpdate) * speed;
+    if (transitionLive)
     {
-        displayMenu();
+        outgoingTime += (t - lastUpdate) * speed;
     }
-    else
+    for (Segment& s : segments)
+    {
+        s.effectTime += (t - lastUpdate) * s.config.speed;
+    }
+    // New color selections are blended in over several frames
+    const uint32_t morphStart = micros();
+    colors.morph();
+    for (Segment& s : segments)
+    {
+        s.colors.morph();
+    }
+    morphTime = micros() - morphStart;
+    runEffect();
+    publishColors();
+    const bool menuActive = menu->isActive();
+    if (progressActive)
     {
-        effectTime += (t - lastUpdate) * speed;
-        runEffect();
+        displayProgress();
     }
+    if (menuActive)
+    {
+        displayMenu();
+    }
+    layers.setVisible(backdropLayer, progressActive || menuActive);
+    layers.setVisible(overlayLayer, progressActive);
+    layers.setVisible(menuLayer, menuActive);
+    layers.compose(leds, frame, numLeds);
     lastUpdate = t;
+    const bool limitSettled = limitCurrent(writeOutput());
+    if (outputStatic && limitSettled)
+    {
+        idle = true;
+        idleSettings = settings;
+        idleSegmentVersion = segmentVersion;
+        // Not refreshed while idle, so show the rounded values
+        refreshOutput();
+    }
+    lastRefresh = t;
     FastLED.show();
 }
 
 void TreeLight::resetEffect(bool timerOnly)
 {
-    effectTime = 0;
-    // Save last effect colors
+    if (timerOnly)
+    {
+        // Color change of the same effect, fade over from the last frame
+        if (!transitionLive)
+        {
+            startTransition(TransitionType::crossfade, false);
+        }
+        effectTime = 0;
+        keyframesValid = false;
+        TreeEffects::reset(effectSlot, true);
+    }
+    else
+    {
+        // Only two effects fit into the arena, so a transition which is still running continues from its last frame
+        const bool live = !transitionActive;
+        startTransition(transitionType, live);
+        outgoingTime = effectTime;
+        effectTime = 0;
+        // The other slot is free or holds the outgoing effect of the old transition
+        effectSlot = getOutgoingSlot();
+        TreeEffects::create(effectSlot, currentEffectType);
+        keyframesValid = false;
+        if (!live)
+        {
+            TreeEffects::destroy(getOutgoingSlot());
+        }
+    }
+}
+
+void TreeLight::seek(unsigned long time)
+{
+    effectTime = time;
+    // The keyframes are from another time, interpolating from them would show a jump
+    keyframesValid = false;
+}
+
+TreeColors& TreeLight::getTargetColors(uint8_t target)
+{
+    if (target < TreeEffects::maxSegments)
+    {
+        return segments[target].colors;
+    }
+    return colors;
+}
+
+void TreeLight::startTransition(TransitionType type, bool live)
+{
+    if (transitionLive && !live)
+    {
+        TreeEffects::destroy(getOutgoingSlot());
+    }
+    // The shown frame, also the first outgoing frame of a live transition
     ledBackup = leds;
-    if (currentEffect)
+    activeTransition = type;
+    transitionActive = true;
+    transitionLive = live;
+    transitionStart = millis();
+    // From the colors, so a fixed seed also repeats the transitions
+    transitionSeed = colors.randomByte();
+    if (live)
+    {
+        ++liveTransitions;
+    }
+    else
     {
-        currentEffect->reset(timerOnly);
+        ++snapshotTransitions;
     }
 }
 
+void TreeLight::endTransition()
+{
+    if (transitionLive)
+    {
+        TreeEffects::destroy(getOutgoingSlot());
+    }
+    transitionActive = false;
+    transitionLive = false;
+}
+
 void TreeLight::setBrightnessLevel(uint8_t level)
 {
     brightnessLevel = level;
@@ -174,7 +451,8 @@ void TreeLight::setBrightnessLevel(uint8_t level)
         scale = 255;
         break;
     }
-    FastLED.setBrightness(scale);
+    brightnessScale = scale;
+    outputLut.setBrightness(brightnessScale * currentLimit >> 8);
 }
 
 void TreeLight::initColorMenu()
@@ -185,25 +463,172 @@ void TreeLight::initColorMenu()
     menu->setSubSelection(colors.getSelection());
 }
 
-void TreeLight::runEffect()
+void TreeLight::showProgress(uint8_t progress, CRGB color)
+{
+    progressActive = true;
+    this->progress = progress;
+    progressColor = color;
+}
+
+TreeColors TreeLight::getColorSnapshot() const
+{
+    lockColorSnapshot();
+    const TreeColors snapshot = colorSnapshot;
+    unlockColorSnapshot();
+    return snapshot;
+}
+
+void TreeLight::publishColors()
+{
+    lockColorSnapshot();
+    colorSnapshot = colors;
+    unlockColorSnapshot();
+}
+
+bool TreeLight::isOutputStatic() const
 {
-    const unsigned int colorDuration = 60000;
-    const unsigned int startFadeIn = 2000;
-    IEffect::EffectControl c;
+    if (progressActive || menu->isActive())
+    {
+        return false;
+    }
+    // Effects only depend on the effect time, which does not advance when stopped, and the colors
+    if (transitionActive || colors.isMorphing() || (speed != 0 && currentEffectType != EffectType::off))
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < TreeEffects::maxSegments; ++i)
+    {
+        if (segments[i].config.enabled && !isSegmentStatic(i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t TreeLight::getOutputSettings() const
+{
+    return (uint32_t)currentEffectType | ((uint32_t)speed << 8) | ((uint32_t)brightnessLevel << 16)
+        | ((uint32_t)colors.getSelection() << 24);
+}
+
+void TreeLight::setCalibration(const char* hex)
+{
+    fill_solid(calibration, numLeds, CRGB::White);
+    calibrated = false;
+    for (uint8_t led = 0; led < numLeds; ++led)
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < 6; ++i)
+        {
+            const char c = *hex++;
+            uint8_t digit;
+            if (c >= '0' && c <= '9')
+            {
+                digit = c - '0';
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                digit = c - 'a' + 10;
+            }
+            else if (c >= 'A' && c <= 'F')
+            {
+                digit = c - 'A' + 10;
+            }
+            else
+            {
+                return;
+            }
+            value = (value << 4) | digit;
+        }
+        calibration[led] = CRGB(value);
+        calibrated = true;
+    }
+}
+
+uint32_t TreeLight::writeOutput()
+{
+    const uint32_t sum = outputLut.apply(frame, outputValues, numLeds, calibrated ? calibration : nullptr);
+    refreshOutput();
+    return sum;
+}
 
+void TreeLight::refreshOutput()
+{
+    if (dithering && !idle)
+    {
+        OutputLut::dither(outputValues, ditherError, output, numLeds);
+    }
+    else
+    {
+        OutputLut::round(outputValues, output, numLeds);
+    }
+}
+
+bool TreeLight::limitCurrent(uint32_t outputSum)
+{
+    // Gamma and correction are already applied, the brightness and limit scale the current linearly
+    const uint32_t shownCurrent = outputSum * channelCurrent / 255;
+    const uint32_t limitedBrightness = outputLut.getBrightness();
+    const uint32_t ledCurrent = limitedBrightness != 0 ? shownCurrent * brightnessScale / limitedBrightness : 0;
+    const uint32_t baseCurrent = controllerCurrent + numLeds * ledIdleCurrent;
+
+    uint16_t target = 256;
+    if (maxCurrent != 0 && maxCurrent <= baseCurrent)
+    {
+        target = 0;
+    }
+    else if (maxCurrent != 0 && baseCurrent + ledCurrent > maxCurrent)
+    {
+        target = (maxCurrent - baseCurrent) * 256 / ledCurrent;
+    }
+    if (target < currentLimit)
+    {
+        // Fast attack, half of the difference every frame
+        currentLimit -= (currentLimit - target + 1) / 2;
+    }
+    else
+    {
+        // Slow release
+        currentLimit += (target - currentLimit + 15) / 16;
+    }
+    estimatedCurrent = baseCurrent + shownCurrent;
+    const uint8_t brightness = brightnessScale * currentLimit >> 8;
+    const bool settled = currentLimit == target && brightness == outputLut.getBrightness();
+    outputLut.setBrightness(brightness);
+    return settled;
+}
+
+void TreeLight::runEffect()
+{
+    const uint32_t renderStart = micros();
     TreeLightView v(*this);
-    if (currentEffect != nullptr)
+    const EffectControl c = runCurrentEffect(v);
+
+    const unsigned long transitionTime = millis() - transitionStart;
+    if (transitionActive && transitionTime >= transitionDuration)
+    {
+        endTransition();
+    }
+    if (transitionLive)
     {
-        c = currentEffect->runEffect(v, leds, effectTime);
+        TreeLightView outgoing(*this, TreeLightView::outgoingEffect);
+        TreeEffects::run(getOutgoingSlot(), outgoing, ledBackup, outgoingTime);
+    }
+    renderTime = micros() - renderStart;
+    if (transitionLive && renderTime > renderBudget)
+    {
+        // Both effects do not fit into the frame, continue with the last outgoing frame
+        DEBUGF("Transition over budget: %u us\n", (unsigned)renderTime);
+        TreeEffects::destroy(getOutgoingSlot());
+        transitionLive = false;
+        ++snapshotTransitions;
     }
 
-    if (speed > 0 && c.fadeOver && effectTime < startFadeIn)
+    if (transitionActive && c.fadeOver)
     {
-        // TODO: does not work when speed = 0
-        // Scale 0 to startFadeIn
-        uint8_t fade = min((startFadeIn - effectTime) * 256 / startFadeIn, (unsigned long)255);
-        fade = ease8InOutCubic(fade);
-        leds.nblend(ledBackup, fade);
+        const uint8_t progress = min(transitionTime * 256 / transitionDuration, (unsigned long)255);
+        TreeTransitions::apply(activeTransition, leds, ledBackup, numLeds, progress, transitionSeed);
     }
     else if (c.allowAutoColorChange && effectTime > colorDuration)
     {
@@ -211,33 +636,173 @@ void TreeLight::runEffect()
         resetEffect();
         colors.updateColor();
     }
+    runSegments();
+}
+
+EffectControl TreeLight::runCurrentEffect(TreeLightView& v)
+{
+    const unsigned long period = TreeEffects::getPeriod(currentEffectType);
+    // Colors change in every frame of a morph, caching them would only cost time
+    if (period == 0 || colors.isMorphing()
+        || !periodCache.select(currentEffectType, colors.getVersion(), period, numLeds))
+    {
+        const uint8_t interval = TreeEffects::getKeyframeInterval(currentEffectType);
+        if (interval > 1)
+        {
+            return runKeyframes(v, interval);
+        }
+        return TreeEffects::run(effectSlot, v, leds, effectTime);
+    }
+    const uint32_t start = micros();
+    if (periodCache.isComplete())
+    {
+        periodCache.play(leds, effectTime);
+        periodCache.countHit(micros() - start);
+        // Cached effects do not control color changes or fading
+        return {};
+    }
+    const EffectControl c = TreeEffects::run(effectSlot, v, leds, effectTime);
+    periodCache.countMiss(micros() - start);
+    // Only a few keyframes per frame, so filling the cache stays within the render budget
+    for (uint8_t i = 0; i < PeriodCache::fillPerFrame && !periodCache.isComplete(); ++i)
+    {
+        CRGBSet keyframe(periodCache.getFillFrame(), numLeds);
+        TreeEffects::run(effectSlot, v, keyframe, periodCache.getFillTime());
+        periodCache.frameFilled();
+    }
+    return c;
+}
+
+EffectControl TreeLight::runKeyframes(TreeLightView& v, uint8_t interval)
+{
+    const uint32_t start = micros();
+    // New effect or effect time, start again without the old keyframe
+    const bool restart = !keyframesValid;
+    const bool evaluate = restart || ++keyframeStep >= interval;
+    if (evaluate)
+    {
+        keyframePrev = keyframeNext;
+        keyframeControl = TreeEffects::run(effectSlot, v, keyframeNext, effectTime);
+        if (restart)
+        {
+            keyframePrev = keyframeNext;
+        }
+        keyframesValid = true;
+        keyframeStep = 0;
+    }
+    // Linear over the whole interval, reaches the next keyframe in the frame before the following one is rendered
+    const uint8_t amount = (uint16_t)(keyframeStep + 1) * 255 / interval;
+    for (uint8_t i = 0; i < numLeds; ++i)
+    {
+        leds[i] = blend(keyframePrev[i], keyframeNext[i], amount);
+    }
+    const uint32_t time = micros() - start;
+    if (evaluate)
+    {
+        keyframeRenderTime = time;
+    }
+    else
+    {
+        ++interpolatedFrames;
+        if (keyframeRenderTime > time)
+        {
+            interpolationSaved += keyframeRenderTime - time;
+        }
+    }
+    return keyframeControl;
+}
+
+void TreeLight::runSegments()
+{
+    for (uint8_t i = 0; i < TreeEffects::maxSegments; ++i)
+    {
+        Segment& s = segments[i];
+        if (!s.config.enabled)
+        {
+            continue;
+        }
+        if (!isSegmentStatic(i))
+        {
+            const uint32_t start = micros();
+            const uint8_t slot = TreeEffects::firstSegmentSlot + i;
+            TreeLightView v(*this, i);
+            // Effects are made for the whole tree, so render all LEDs and only show the range of the segment
+            const EffectControl c = TreeEffects::run(slot, v, segmentFrame, s.effectTime);
+            if (c.allowAutoColorChange && s.effectTime > colorDuration)
+            {
+                s.effectTime = 0;
+                TreeEffects::reset(slot, true);
+                s.colors.updateColor();
+            }
+            segmentPixels(s.config.start, s.config.end) = segmentFrame(s.config.start, s.config.end);
+            s.rendered = true;
+            s.renderTime = micros() - start;
+        }
+        leds(s.config.start, s.config.end) = segmentPixels(s.config.start, s.config.end);
+    }
+}
+
+bool TreeLight::isSegmentStatic(uint8_t index) const
+{
+    const Segment& s = segments[index];
+    // Effects only depend on the effect time and the colors
+    return s.rendered && !s.colors.isMorphing() && (s.config.speed == 0 || s.config.effect == EffectType::off);
+}
+
+void TreeLight::setSegment(uint8_t index, const SegmentConfig& config)
+{
+    if (index >= TreeEffects::maxSegments || config.start > config.end || config.end >= numLeds
+        || (config.enabled && !TreeEffects::isEnabled(config.effect))
+        || !TreeColors::isSelectionEnabled(config.colorSelection) || config.speed >= (uint8_t)Speed::maxValue)
+    {
+        return;
+    }
+    Segment& s = segments[index];
+    if (s.config == config)
+    {
+        return;
+    }
+    const uint8_t slot = TreeEffects::firstSegmentSlot + index;
+    if (!config.enabled)
+    {
+        TreeEffects::destroy(slot);
+    }
+    else if (!s.config.enabled || s.config.effect != config.effect)
+    {
+        TreeEffects::create(slot, config.effect);
+        s.effectTime = 0;
+    }
+    s.colors.setSelection(config.colorSelection);
+    s.config = config;
+    s.rendered = false;
+    ++segmentVersion;
 }
 
 void TreeLight::displayMenu()
 {
-    leds.fill_solid(CRGB::Black);
+    menuPixels.fill_solid(CRGB::Black);
     CRGB color = CRGB::White;
     if (menu->getMenuState() == Menu::MenuState::mainSelect)
     {
         switch (menu->getLongPressMode())
         {
         case 1:
-            leds[12] = color;
+            menuPixels[12] = color;
             break;
         case 2:
-            leds(8, 11) = color;
+            menuPixels(8, 11) = color;
             break;
         case 3:
-            leds(0, 7) = color;
+            menuPixels(0, 7) = color;
             break;
         case 4:
-            leds(0, 7) = CRGB::Blue;
+            menuPixels(0, 7) = CRGB::Blue;
             break;
         }
     }
     else if (menu->getMenuState() == Menu::MenuState::brightnessSelect)
     {
-        leds(0, brightnessLevel - 1) = color;
+        menuPixels(0, brightnessLevel - 1) = color;
     }
     else if (menu->getMenuState() == Menu::MenuState::colorSelect)
     {
@@ -253,20 +818,40 @@ void TreeLight::displayMenu()
             menuTime = t;
             colors.updateColor();
         }
-        leds[12] = colors.firstColor();
+        menuPixels[12] = colors.firstColor();
         if (colors.isColorPalette())
         {
             uint8_t mix = (t / 64);
             for (uint8_t i = 8; i < 12; ++i)
             {
-                leds[i] = colors.getPaletteColor(mix, false);
+                menuPixels[i] = colors.getPaletteColor(mix, false);
                 mix += 64;
             }
         }
         else
         {
-            leds(8, 11) = colors.secondColor();
+            menuPixels(8, 11) = colors.secondColor();
         }
-        leds[colors.getSelection()] = CRGB::White;
+        menuPixels[colors.getSelection()] = CRGB::White;
+    }
+    layers.setMask(menuLayer, LayerCompositor::maskOf(menuPixels, numLeds));
+}
+
+void TreeLight::displayProgress()
+{
+    // LED order is bottom ring, middle ring, top, so the bar grows upwards
+    const uint16_t scaled = (uint16_t)progress * numLeds;
+    const uint8_t full = scaled >> 8;
+    overlay.fill_solid(CRGB::Black);
+    if (full > 0)
+    {
+        overlay(0, full - 1) = progressColor;
+    }
+    if (full < numLeds)
+    {
+        // Partial brightness for the next LED
+        overlay[full] = progressColor;
+        overlay[full].nscale8_video(scaled & 0xFF);
     }
+    layers.setMask(overlayLayer, LayerCompositor::maskOf(overlay, numLeds));
 }
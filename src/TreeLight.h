@@ -4,9 +4,20 @@
 #include <ArduinoJson.h>
 #include <FastLED.h>
 
+#include "LayerCompositor.h"
 #include "Menu.h"
+#include "OutputLut.h"
+#include "PeriodCache.h"
+#include "Segment.h"
 #include "TreeColors.h"
 #include "TreeEffects.h"
+#include "TreeTransitions.h"
+
+/// Fixed seed for the random colors, e.g. -DRANDOM_SEED=1 to get the same colors after every start. 0 seeds from
+/// hardware noise.
+#ifndef RANDOM_SEED
+#define RANDOM_SEED 0
+#endif
 
 // Config:
 // - brighness
@@ -44,16 +55,23 @@ public:
 
     void init(Menu& menu);
     void getStatusJsonString(JsonObject& output);
-    static const char* effect_names[];
+    ///@brief Name in flash, nullptr for invalid and disabled effects
+    const __FlashStringHelper* getEffectName(EffectType e) const;
+
+    ///@brief Apply brightness, speed, effect and color from settings, missing or invalid values are ignored
+    void applySettings(const JsonObjectConst& settings);
 
     void nextEffect();
     void setEffect(EffectType e);
     EffectType getEffectType() const { return currentEffectType; }
-    IEffect* getEffect() const { return currentEffect; }
     void nextSpeed();
     void setSpeed(Speed s);
     uint8_t getSpeed() const { return speed; }
     void update();
+    ///@brief True if the output is static and was not updated in the last call to @ref update
+    ///
+    /// This is the case when the effect is off or stopped and neither the menu nor a progress is shown.
+    bool isIdle() const { return idle; }
     void setLED(const uint8_t led, const CRGB color)
     {
         if (led > leds.size())
@@ -61,9 +79,14 @@ public:
             return;
         }
         leds[led] = color;
+        layers.compose(leds, frame, numLeds);
+        writeOutput();
         FastLED.show();
     }
     void resetEffect(bool timerOnly = true);
+    ///@brief Jump to a time of the current effect, e.g. to show the same frame as another tree
+    void seek(unsigned long time);
+    unsigned long getEffectTime() const { return effectTime; }
     void setBrightnessLevel(uint8_t level);
     uint8_t getBrightnessLevel() const { return brightnessLevel; }
 
@@ -74,13 +97,49 @@ public:
             return;
         }
         leds(start, end) = color;
+        layers.compose(leds, frame, numLeds);
+        writeOutput();
         FastLED.show();
     }
     void initColorMenu();
+
+    ///@brief Show a progress bar instead of the effect, from the bottom to the top
+    ///@param progress Progress from 0 to 255
+    void showProgress(uint8_t progress, CRGB color);
+    void hideProgress() { progressActive = false; }
+
     void setColorSelection(uint8_t index) { colors.setSelection(index); }
 
+    ///@brief Set the current budget of the supply in mA, brightness is reduced to stay below it. 0 for no limit
+    void setMaxCurrent(uint16_t current) { maxCurrent = current; }
+
+    ///@brief Scale the output of every LED, to even out differences between LEDs
+    ///@param hex Scale of each LED in chain order as RRGGBB, for example "FFFFFF" for no change. Missing or invalid
+    ///           entries and the LEDs after them are not scaled, an empty string turns the calibration off.
+    void setCalibration(const char* hex);
+
+    ///@brief Enable temporal dithering, smoother at low brightness but the LEDs are refreshed every @ref ditherInterval
+    void setDithering(bool enabled) { dithering = enabled; }
+    ///@brief ms between two calls of @ref update, so neither a frame nor a dithering refresh is late
+    unsigned long getUpdateInterval() const { return dithering ? ditherInterval : frameInterval; }
+
+    ///@brief Set the transition when the effect changes
+    void setTransition(TransitionType type)
+    {
+        if (type < TransitionType::maxValue)
+        {
+            transitionType = type;
+        }
+    }
+
     const TreeColors& getColors() const { return colors; }
     TreeColors& getColors() { return colors; }
+    ///@brief Copy of the colors of the last frame, which can be taken from another task
+    TreeColors getColorSnapshot() const;
+
+    ///@brief Configure a segment, which shows its own effect over the LEDs start to end. Invalid values are ignored.
+    void setSegment(uint8_t index, const SegmentConfig& config);
+    const SegmentConfig& getSegment(uint8_t index) const { return segments[index].config; }
 
 public:
 #if defined(ESP8266)
@@ -89,44 +148,172 @@ public:
     static constexpr uint8_t pin = 3;
 #endif
     static constexpr uint8_t numLeds = 13;
+    static_assert(numLeds <= 32, "Layer masks have one bit per LED");
+    static constexpr unsigned long frameInterval = 10; // ms
+    // ms between dithering refreshes, FastLED waits 2.5 ms between two refreshes of clockless LEDs
+    static constexpr unsigned long ditherInterval = 3;
+    static constexpr unsigned long transitionDuration = 1000; // ms to fade over from the last effect
+    static constexpr unsigned long colorDuration = 60000; // effect time until effects which allow it change color
+    // us for rendering the effects of a frame, a live transition falls back to a snapshot above it
+    static constexpr uint32_t renderBudget = 1000;
+    static constexpr uint8_t backdropLevel = 48; // Effect brightness under the menu and notifications
+    // Estimated currents in mA
+    static constexpr uint32_t channelCurrent = 20; // One color at full brightness
+    static constexpr uint32_t ledIdleCurrent = 1;
+    static constexpr uint32_t controllerCurrent = 80; // Microcontroller with wifi
 
 private:
     void runEffect();
+    ///@brief Start a transition from the shown frame
+    ///@param live Keep rendering the effect in the other slot as outgoing effect
+    void startTransition(TransitionType type, bool live);
+    void endTransition();
+    TreeColors& getTargetColors(uint8_t target);
+    ///@brief Render the current effect into @ref leds, or play it from the period cache
+    EffectControl runCurrentEffect(TreeLightView& v);
+    ///@brief Render the current effect every interval frames and interpolate the frames between
+    EffectControl runKeyframes(TreeLightView& v, uint8_t interval);
+    ///@brief Render the segments over @ref leds, static segments are only copied
+    void runSegments();
+    bool isSegmentStatic(uint8_t index) const;
+    ///@brief Copy the colors for @ref getColorSnapshot
+    void publishColors();
+    uint8_t getOutgoingSlot() const { return effectSlot ^ 1; }
     void displayMenu();
+    void displayProgress();
+    ///@brief True if the next frame would be the same as the last one
+    bool isOutputStatic() const;
+    ///@brief Settings which change a static output
+    uint32_t getOutputSettings() const;
+    ///@brief Map @ref frame to the output values
+    ///@returns Sum of all output channels
+    uint32_t writeOutput();
+    ///@brief Write the next dithering step of the output values, or the rounded values when not dithering
+    void refreshOutput();
+    ///@brief Estimate the current of the shown frame and adjust the brightness limit for the next one
+    ///@param outputSum Sum of all output channels
+    ///@returns true if the limit does not change anymore
+    bool limitCurrent(uint32_t outputSum);
 
 private:
     Menu* menu;
-    CRGBArray<numLeds> leds;
-    CRGBArray<numLeds> ledBackup; // For fade over from different effect
+    CRGBArray<numLeds> leds; // Effect layer
+    CRGBArray<numLeds> frame; // Effect with all layers composed
+    CRGBArray<numLeds> overlay; // Notifications like the progress bar
+    CRGBArray<numLeds> menuPixels;
+    LayerCompositor layers;
+    int8_t backdropLayer = -1;
+    int8_t overlayLayer = -1;
+    int8_t menuLayer = -1;
+    CRGBArray<numLeds> output; // Sent to the LEDs, with gamma, correction and brightness
+    OutputLut outputLut;
+    uint16_t outputValues[numLeds * 3]; // Output with 8 fractional bits
+    uint8_t ditherError[numLeds * 3] = {};
+    bool dithering = OutputLut::ditheringDefault;
+    unsigned long lastRefresh = 0;
+    CRGB calibration[numLeds];
+    bool calibrated = false;
+    CRGBArray<numLeds> ledBackup; // Frame of the outgoing effect, rendered during a live transition
     unsigned long effectTime = 0;
     unsigned long lastUpdate = 0;
     EffectType currentEffectType = EffectType::off;
-    IEffect* currentEffect = nullptr;
-    IEffect** effectList;
+    uint8_t effectSlot = 0; // Arena slot of the current effect
+    unsigned long outgoingTime = 0; // Effect time of the outgoing effect
+    unsigned long transitionStart = 0;
+    bool transitionActive = false;
+    bool transitionLive = false; // Outgoing effect is still rendered
+    TransitionType transitionType = TransitionType::crossfade; // For effect changes
+    TransitionType activeTransition = TransitionType::crossfade;
+    uint8_t transitionSeed = 0;
+    uint32_t renderTime = 0; // us to render the effects of the last frame
+    uint32_t morphTime = 0; // us to blend towards new color selections in the last frame
+    PeriodCache periodCache; // Only for the current effect, segments and transitions render directly
+    // Keyframes of the current effect when it is rendered at a lower rate, the output lags one keyframe behind
+    CRGBArray<numLeds> keyframePrev;
+    CRGBArray<numLeds> keyframeNext;
+    EffectControl keyframeControl; // Result of the last keyframe
+    bool keyframesValid = false; // Cleared when the effect is created, reset or seeks
+    uint8_t keyframeStep = 0; // Frames since keyframeNext was rendered
+    uint32_t keyframeRenderTime = 0; // us to render the last keyframe
+    uint32_t interpolatedFrames = 0;
+    uint64_t interpolationSaved = 0; // us, estimated
+    uint16_t liveTransitions = 0;
+    uint16_t snapshotTransitions = 0; // Including live transitions which fell back to a snapshot
+    struct Segment
+    {
+        SegmentConfig config;
+        TreeColors colors;
+        unsigned long effectTime = 0;
+        uint32_t renderTime = 0; // us of the last rendered frame
+        bool rendered = false; // segmentPixels contain a frame of the current effect
+    };
+    Segment segments[TreeEffects::maxSegments];
+    CRGBArray<numLeds> segmentFrame; // Full frame of the segment effect, only its range is shown
+    CRGBArray<numLeds> segmentPixels; // Last frame of all segments, kept for static segments
+    uint8_t segmentVersion = 0; // Changed by every segment change, to leave idle
+    uint8_t idleSegmentVersion = 0;
     uint8_t speed = 2;
     uint8_t brightnessLevel = 4;
+    uint8_t brightnessScale = 64; // Brightness of the selected level
+    uint16_t maxCurrent = 0; // mA
+    uint16_t currentLimit = 256; // Brightness factor in 1/256, 256 when not limited
+    uint16_t estimatedCurrent = 0; // mA of the last frame, with limit
     unsigned long menuTime = 0;
     TreeColors colors;
+    TreeColors colorSnapshot; // Only accessed with the snapshot lock held
+    bool progressActive = false;
+    uint8_t progress = 0;
+    CRGB progressColor;
+    bool idle = false;
+    uint32_t idleSettings = 0; // Settings of the static output
 };
 
 class TreeLightView
 {
 public:
-    TreeLightView(TreeLight& light) : l(&light) { }
+    /// Targets which are not a segment index
+    static constexpr uint8_t currentEffect = 0xFF;
+    static constexpr uint8_t outgoingEffect = 0xFE;
 
-    void resetEffect(bool timerOnly = true) { l->resetEffect(timerOnly); }
-    void updateColor() { l->getColors().updateColor(); }
-    CRGB firstColor() const { return l->getColors().firstColor(); }
-    CRGB secondColor() const { return l->getColors().secondColor(); }
-    bool isColorPalette() const { return l->getColors().isColorPalette(); }
+    ///@param target Effect using the view: current or outgoing effect of the tree, or a segment index
+    TreeLightView(TreeLight& light, uint8_t target = currentEffect) : colors(&light.getTargetColors(target)) { }
+    ///@brief View for rendering off-screen, which does not touch the tree
+    explicit TreeLightView(const TreeColors& colors) : colors(&colors) { }
+
+    ///@brief View which continues the color sequence step colors later, for effects that show other effects
+    TreeLightView withColorStep(uint32_t step) const
+    {
+        TreeLightView v = *this;
+        v.colorStep += step;
+        // Generated once, effects ask for the colors for every pixel
+        v.first = colors->getSequenceColor(v.colorStep);
+        v.second = colors->getSequenceColor(v.colorStep + 1);
+        return v;
+    }
+    ///@brief Color number step of the sequence, which starts with @ref firstColor and @ref secondColor
+    CRGB getSequenceColor(uint32_t step) const { return colors->getSequenceColor(colorStep + step); }
+    CRGB firstColor() const { return colorStep == 0 ? colors->firstColor() : first; }
+    CRGB secondColor() const { return colorStep == 0 ? colors->secondColor() : second; }
+    bool isColorPalette() const { return colors->isColorPalette(); }
 
     CRGB getPaletteColor(uint8_t mix, bool doBlend = true) const
     {
-        return l->getColors().getPaletteColor(mix, doBlend);
+        if (colorStep == 0 || isColorPalette())
+        {
+            return colors->getPaletteColor(mix, doBlend);
+        }
+        if (!doBlend)
+        {
+            return mix < 128 ? first : second;
+        }
+        return blend(first, second, mix);
     }
 
 private:
-    TreeLight* l;
+    const TreeColors* colors;
+    uint32_t colorStep = 0;
+    CRGB first; // Sequence colors at colorStep, when it is not 0
+    CRGB second;
 };
 
 #endif
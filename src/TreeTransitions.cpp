@@ -0,0 +1,100 @@
+#include "TreeTransitions.h"
+
+#include "PixelKernels.h"
+#include "Prng.h"
+
+namespace
+{
+    // Ring of every LED from the bottom (outer ring) to the top, see the LED order in TreeLight.h
+    constexpr uint8_t ledRing[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2};
+    constexpr uint8_t numRings = 3;
+    constexpr uint8_t numTreeLeds = sizeof(ledRing);
+
+    // Progress for a single ring or LED to fade over
+    constexpr uint8_t ringFade = 128;
+    constexpr uint8_t sparkleFade = 64;
+
+    const char* const transitionNames[] = {"crossfade", "ringWipe", "sparkle"};
+    static_assert(sizeof(transitionNames) / sizeof(transitionNames[0]) == (size_t)TransitionType::maxValue,
+        "Every transition needs a name");
+
+    ///@brief Amount of the incoming frame for a part which starts to fade at start and takes width
+    uint8_t partAmount(uint8_t progress, uint8_t start, uint8_t width)
+    {
+        if (progress <= start)
+        {
+            return 0;
+        }
+        return min((progress - start) * 255u / width, 255u);
+    }
+
+    void ringWipe(CRGB* leds, const CRGB* outgoing, uint8_t numLeds, uint8_t progress)
+    {
+        for (uint8_t i = 0; i < numLeds; ++i)
+        {
+            const uint8_t ring = i < numTreeLeds ? ledRing[i] : 0;
+            // Starts are spread so the top ring is done at the end
+            const uint8_t start = ring * (255 - ringFade) / (numRings - 1);
+            nblend(leds[i], outgoing[i], 255 - partAmount(progress, start, ringFade));
+        }
+    }
+
+    void sparkle(CRGB* leds, const CRGB* outgoing, uint8_t numLeds, uint8_t progress, uint8_t seed)
+    {
+        // Every LED gets a different turn in a random order of the seed. Shuffled again every frame, which is cheaper
+        // than storing the order per transition.
+        uint8_t turns[UINT8_MAX];
+        for (uint8_t i = 0; i < numLeds; ++i)
+        {
+            turns[i] = i;
+        }
+        Prng prng;
+        // Spread the seed over the state, xorshift needs a few steps to mix small states
+        prng.seed(seed * 2654435761u);
+        for (uint8_t i = numLeds; i > 1; --i)
+        {
+            const uint8_t j = prng.random(0, i);
+            const uint8_t t = turns[i - 1];
+            turns[i - 1] = turns[j];
+            turns[j] = t;
+        }
+        for (uint8_t i = 0; i < numLeds; ++i)
+        {
+            const uint8_t start = turns[i] * (255 - sparkleFade) / max(numLeds - 1, 1);
+            nblend(leds[i], outgoing[i], 255 - partAmount(progress, start, sparkleFade));
+        }
+    }
+} // namespace
+
+namespace TreeTransitions
+{
+    void apply(TransitionType type, CRGB* leds, const CRGB* outgoing, uint8_t numLeds, uint8_t progress, uint8_t seed)
+    {
+        if (progress == 255)
+        {
+            return;
+        }
+        switch (type)
+        {
+        case TransitionType::ringWipe:
+            ringWipe(leds, outgoing, numLeds, progress);
+            break;
+        case TransitionType::sparkle:
+            sparkle(leds, outgoing, numLeds, progress, seed);
+            break;
+        case TransitionType::crossfade:
+        default:
+            PixelKernels::nblend(leds, outgoing, numLeds, ease8InOutCubic(255 - progress));
+            break;
+        }
+    }
+
+    const char* getName(TransitionType type)
+    {
+        if (type < TransitionType::maxValue)
+        {
+            return transitionNames[(int)type];
+        }
+        return "";
+    }
+} // namespace TreeTransitions
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+enum class TransitionType : uint8_t
+{
+    crossfade,
+    ringWipe, ///< Rings change from the bottom to the top
+    sparkle, ///< LEDs change one after the other in random order
+    maxValue // Not a transition, number of valid transitions
+};
+
+///@brief Transitions from the frame of the outgoing effect to the frame of the incoming effect
+namespace TreeTransitions
+{
+    ///@brief Blend the outgoing frame over the incoming frame
+    ///@param leds Incoming frame, replaced by the result
+    ///@param outgoing Frame of the outgoing effect, either still rendered or a snapshot
+    ///@param progress 0 shows only the outgoing frame, 255 only the incoming frame
+    ///@param seed Chosen per transition, so the sparkle order changes
+    void apply(TransitionType type, CRGB* leds, const CRGB* outgoing, uint8_t numLeds, uint8_t progress, uint8_t seed);
+
+    const char* getName(TransitionType type);
+} // namespace TreeTransitions
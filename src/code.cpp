@@ -7,11 +7,14 @@
 #include <ESPAsyncWebServer.h>
 #include <FastLED.h>
 
+#include "ButtonInput.h"
 #include "Config.h"
 #include "Constants.h"
 #include "Menu.h"
 #include "Mqtt.h"
 #include "Networking.h"
+#include "PowerManager.h"
+#include "Scheduler.h"
 #include "TreeLight.h"
 
 #if defined(ESP32)
@@ -25,12 +28,17 @@ constexpr uint8_t buttonPin = D2;
 #else
 constexpr uint8_t buttonPin = 2;
 #endif
+// ms between two runs of the network loop, DNS answers and MQTT do not need to be faster
+constexpr uint32_t networkPeriod = 5;
 
-AceButton button(buttonPin);
+ButtonInput buttonInput;
+AceButton button(&buttonInput, buttonPin);
 TreeLight light;
 Menu menu;
 Config config;
 Networking networking {config};
+Scheduler scheduler;
+PowerManager powerManager;
 bool wifiEnabled = false;
 
 void getMacAddress(uint8_t (&mac)[6])
@@ -66,6 +74,15 @@ void init_config()
     light.setColorSelection(effectConfig.colorSelection);
     light.setSpeed((Speed)effectConfig.speed);
     light.setEffect(effectConfig.currentEffectType);
+    for (uint8_t i = 0; i < TreeEffects::maxSegments; ++i)
+    {
+        light.setSegment(i, effectConfig.segments[i]);
+    }
+    light.setMaxCurrent(config.getLedConfig().maxCurrent);
+    light.setDithering(config.getLedConfig().dithering);
+    light.setTransition((TransitionType)config.getLedConfig().transition);
+    static_assert(calibrationLength >= TreeLight::numLeds * 6, "Calibration does not fit all LEDs");
+    light.setCalibration(config.getLedConfig().calibration);
 }
 void toggle_wifi()
 {
@@ -105,6 +122,14 @@ void save_effect()
         effectConfig.currentEffectType = light.getEffectType();
         changed |= true;
     }
+    for (uint8_t i = 0; i < TreeEffects::maxSegments; ++i)
+    {
+        if (effectConfig.segments[i] != light.getSegment(i))
+        {
+            effectConfig.segments[i] = light.getSegment(i);
+            changed |= true;
+        }
+    }
 
     if (changed)
     {
@@ -132,6 +157,7 @@ void selectColor()
 
 void handleButton(AceButton*, uint8_t eventType, uint8_t)
 {
+    buttonInput.eventHandled(eventType);
     if (menu.handleButton(eventType))
     {
         return;
@@ -164,6 +190,69 @@ void handleButton(AceButton*, uint8_t eventType, uint8_t)
     }
 }
 
+void checkButton()
+{
+    // - Debounce
+    // - Single click / double click detection
+    // - Long hold detection
+    // click: change effect
+    // double: speed
+    // long 1s: brightness
+    // long 2s: color (palette)
+    // long 3s: WiFi
+    buttonInput.check(button);
+}
+
+void updateLight()
+{
+    light.update();
+    powerManager.update(light.isIdle());
+}
+
+#if defined(ESP8266) || defined(ESP32)
+void networkLoop()
+{
+    networking.loop();
+    // Uploads are only acknowledged after they are written, so they are written as fast as possible
+    scheduler.setPeriod(networkLoop, networking.isUpdating() ? 0 : networkPeriod);
+}
+
+void networkUpdate()
+{
+    networking.update();
+}
+#endif
+
+#ifdef DEBUG_PRINT
+void printDiagnostics()
+{
+    DEBUG(millis() / 1000);
+    DEBUG(" - Current effect ");
+    DEBUG((int)light.getEffectType());
+    DEBUG(" ");
+    DEBUG(light.getEffectName(light.getEffectType()));
+    DEBUG(", FPS: ");
+    DEBUGLN(FastLED.getFPS());
+}
+#endif
+
+void initTasks()
+{
+    // Frame output first, with dithering it also refreshes the LEDs between frames
+    scheduler.addTask("light", updateLight, light.getUpdateInterval(), 50, Scheduler::Priority::high, 2000);
+    // Edges are captured by an interrupt, this only has to detect time based events
+    scheduler.addTask("button", checkButton, 10, 50, Scheduler::Priority::high, 500);
+#if defined(ESP8266) || defined(ESP32)
+    // DNS and OTA writes
+    scheduler.addTask("network", networkLoop, networkPeriod, 50, Scheduler::Priority::normal, 5000);
+    // MQTT and restart after config changes
+    scheduler.addTask("housekeeping", networkUpdate, 1000, 1000, Scheduler::Priority::low, 10000);
+#endif
+#ifdef DEBUG_PRINT
+    scheduler.addTask("diagnostics", printDiagnostics, 1000, 1000, Scheduler::Priority::low, 5000);
+#endif
+}
+
 void setup()
 {
     light.init(menu);
@@ -173,6 +262,7 @@ void setup()
 #endif
 
     pinMode(buttonPin, INPUT);
+    buttonInput.begin(buttonPin);
     ButtonConfig* buttonConfig = button.getButtonConfig();
     buttonConfig->setEventHandler(handleButton);
     buttonConfig->setFeature(ButtonConfig::kFeatureSuppressAfterClick);
@@ -190,62 +280,11 @@ void setup()
     menu.setMainCallback(3, save_effect);
     menu.setMainCallback(4, toggle_wifi);
     menu.setBrightnessCallback(updateBrightness);
-}
 
-#ifdef DEBUG_PRINT
-unsigned long printTime = 0;
-#endif
+    initTasks();
+}
 
 void loop()
 {
-    // 1. Check button state:
-    //    - Debounce
-    //    - Single click / double click detection
-    //    - Long hold detection
-    // 2. Process button update
-    // 3. Update LEDs (if necessary)
-    // 4. wait until next update / button poll
-
-    // click: change effect
-    // double: speed
-    // long 1s: brightness
-    // long 2s: color (palette)
-    // long 3s: WiFi
-
-    // 1. & 2.
-    button.check();
-
-    // 3.
-    light.update();
-    delay(1);
-
-#if defined(ESP8266) || defined(ESP32)
-    EVERY_N_SECONDS(1)
-    {
-        networking.update();
-    }
-#endif
-
-#ifdef DEBUG_PRINT
-    unsigned long t = millis();
-    if (t - printTime > 1000)
-    {
-        printTime = t;
-        DEBUG(t / 1000);
-        DEBUG(" - Current effect ");
-        DEBUG((int)light.getEffectType());
-        IEffect* e = light.getEffect();
-        DEBUG(" ");
-        if (e)
-        {
-            DEBUG(e->getName());
-        }
-        else
-        {
-            DEBUG("NULL");
-        }
-        DEBUG(", FPS: ");
-        DEBUGLN(FastLED.getFPS());
-    }
-#endif
+    scheduler.run();
 }
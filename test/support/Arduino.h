@@ -0,0 +1,196 @@
+#pragma once
+
+// Arduino API for the native tests, only the parts used by the sources which are built for them
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "pgmspace.h"
+
+using std::max;
+using std::min;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+///@brief Time of millis and micros, tests which need reproducible timing stop it and advance it themselves
+struct HostClock
+{
+    static inline bool manual = false;
+    static inline uint64_t now = 0; ///< us while manual
+
+    static void advance(uint32_t ms) { now += ms * 1000ull; }
+};
+
+inline uint32_t micros()
+{
+    if (HostClock::manual)
+    {
+        return (uint32_t)HostClock::now;
+    }
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+inline uint32_t millis()
+{
+    return micros() / 1000;
+}
+inline void delay(unsigned long) { }
+inline void yield() { }
+inline void randomSeed(unsigned long seed)
+{
+    srand(seed);
+}
+
+class String
+{
+public:
+    String(const char* s = "") : str(s) { }
+    const char* c_str() const { return str.c_str(); }
+    size_t length() const { return str.size(); }
+
+private:
+    std::string str;
+};
+
+class IPAddress
+{
+public:
+    IPAddress() = default;
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes {a, b, c, d} { }
+    IPAddress(uint32_t address) { memcpy(bytes, &address, sizeof(bytes)); }
+    operator uint32_t() const
+    {
+        uint32_t address;
+        memcpy(&address, bytes, sizeof(address));
+        return address;
+    }
+    uint8_t operator[](int index) const { return bytes[index]; }
+    bool fromString(const char* s)
+    {
+        unsigned values[4];
+        char end;
+        if (sscanf(s, "%u.%u.%u.%u%c", &values[0], &values[1], &values[2], &values[3], &end) != 4)
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            if (values[i] > 255)
+            {
+                return false;
+            }
+            bytes[i] = values[i];
+        }
+        return true;
+    }
+
+private:
+    uint8_t bytes[4] = {};
+};
+
+class Print
+{
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            write(buffer[i]);
+        }
+        return size;
+    }
+    size_t write(const char* s) { return write(reinterpret_cast<const uint8_t*>(s), strlen(s)); }
+    size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+    size_t write(char c) { return write((uint8_t)c); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write(c); }
+    size_t print(long n) { return printf("%ld", n); }
+    size_t print(unsigned long n) { return printf("%lu", n); }
+    size_t print(int n) { return print((long)n); }
+    size_t print(unsigned n) { return print((unsigned long)n); }
+    size_t print(unsigned char n) { return print((unsigned long)n); }
+    size_t print(double n) { return printf("%.2f", n); }
+    template <typename T>
+    size_t println(const T& value)
+    {
+        return print(value) + write("\r\n");
+    }
+    size_t println() { return write("\r\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        const int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return n > 0 ? write(reinterpret_cast<const uint8_t*>(buffer), min((size_t)n, sizeof(buffer) - 1)) : 0;
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+///@brief Debug output of the sources, discarded unless TEST_SERIAL_OUTPUT is defined
+class HostSerial : public Print
+{
+public:
+    size_t write(uint8_t c) override
+    {
+#ifdef TEST_SERIAL_OUTPUT
+        putchar(c);
+#endif
+        return 1;
+    }
+    using Print::write;
+};
+inline HostSerial Serial;
+
+///@brief Flash of the chip, tests set the running image with @ref setSketch
+class EspClass
+{
+public:
+    void setSketch(const uint8_t* data, uint32_t size)
+    {
+        sketch = data;
+        sketchSize = size;
+    }
+    uint32_t getSketchSize() const { return sketchSize; }
+    uint32_t getFreeSketchSpace() const { return 0x100000; }
+    bool flashRead(uint32_t offset, uint8_t* data, size_t size) const
+    {
+        if (sketch == nullptr || offset > sketchSize || size > sketchSize - offset)
+        {
+            return false;
+        }
+        memcpy(data, sketch + offset, size);
+        return true;
+    }
+    void restart() { ++restarts; }
+
+    uint32_t restarts = 0;
+
+private:
+    const uint8_t* sketch = nullptr;
+    uint32_t sketchSize = 0;
+};
+inline EspClass ESP;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+///@brief Connection which counts acknowledged bytes like the lwip window
+///
+/// Tests call @ref receive for every TCP packet, with a callback which passes the payload to the code under test.
+class AsyncClient
+{
+public:
+    ///@brief Receive a packet of len bytes, it is acknowledged unless ackLater is called from the callback
+    template <typename Callback>
+    void receive(size_t len, Callback&& callback)
+    {
+        delayAck = false;
+        callback();
+        if (delayAck)
+        {
+            unacked += len;
+        }
+        else
+        {
+            acked += len;
+        }
+    }
+    void ackLater() { delayAck = true; }
+    size_t ack(size_t len)
+    {
+        const size_t n = min(len, unacked);
+        unacked -= n;
+        acked += n;
+        return n;
+    }
+
+    size_t unacked = 0; ///< Received bytes which were not acknowledged yet, they shrink the window
+    size_t acked = 0;
+
+private:
+    bool delayAck = false;
+};
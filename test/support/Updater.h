@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MD5Builder.h>
+
+#include <vector>
+
+///@brief Firmware updater which writes the new image into memory
+class UpdaterClass
+{
+public:
+    bool begin(size_t maxSize)
+    {
+        image.clear();
+        this->maxSize = maxSize;
+        expectedMd5[0] = '\0';
+        error = nullptr;
+        running = true;
+        return true;
+    }
+    void runAsync(bool) { }
+    bool setMD5(const char* md5)
+    {
+        if (strlen(md5) != 32)
+        {
+            return false;
+        }
+        strcpy(expectedMd5, md5);
+        return true;
+    }
+    size_t write(const uint8_t* data, size_t len)
+    {
+        if (!running || image.size() + len > maxSize)
+        {
+            error = "Not enough space";
+            return 0;
+        }
+        image.insert(image.end(), data, data + len);
+        return len;
+    }
+    bool end(bool evenIfRemaining = false)
+    {
+        if (!running)
+        {
+            return false;
+        }
+        running = false;
+        if (error != nullptr)
+        {
+            return false;
+        }
+        if (expectedMd5[0] != '\0')
+        {
+            MD5Builder md5;
+            md5.begin();
+            md5.add(image.data(), image.size());
+            md5.calculate();
+            char actual[33];
+            md5.getChars(actual);
+            if (strcmp(actual, expectedMd5) != 0)
+            {
+                error = "MD5 Check Failed";
+                return false;
+            }
+        }
+        finished = true;
+        return true;
+    }
+    String getErrorString() const { return String(error != nullptr ? error : "No Error"); }
+
+    std::vector<uint8_t> image; ///< Data written since begin
+    bool finished = false; ///< Last update ended successfully
+
+private:
+    size_t maxSize = 0;
+    char expectedMd5[33] = "";
+    const char* error = nullptr;
+    bool running = false;
+};
+inline UpdaterClass Update;
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <deque>
+#include <vector>
+
+///@brief UDP socket which receives from and sends to queues of the test
+class WiFiUDP
+{
+public:
+    using Packet = std::vector<uint8_t>;
+
+    uint8_t begin(uint16_t) { return 1; }
+    void stop() { }
+
+    int parsePacket()
+    {
+        if (received().empty())
+        {
+            return 0;
+        }
+        current = received().front();
+        received().pop_front();
+        readPos = 0;
+        return current.size();
+    }
+    int read(uint8_t* buffer, size_t len)
+    {
+        const size_t n = min(len, current.size() - readPos);
+        memcpy(buffer, current.data() + readPos, n);
+        readPos += n;
+        return n;
+    }
+    IPAddress remoteIP() const { return IPAddress(192, 168, 4, 2); }
+    uint16_t remotePort() const { return 5353; }
+
+    int beginPacket(IPAddress, uint16_t)
+    {
+        out.clear();
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t len)
+    {
+        out.insert(out.end(), buffer, buffer + len);
+        return len;
+    }
+    int endPacket()
+    {
+        sent().push_back(out);
+        return 1;
+    }
+
+    ///@brief Packets which are received next by all sockets
+    static std::deque<Packet>& received()
+    {
+        static std::deque<Packet> packets;
+        return packets;
+    }
+    ///@brief Packets sent by all sockets
+    static std::vector<Packet>& sent()
+    {
+        static std::vector<Packet> packets;
+        return packets;
+    }
+
+private:
+    Packet current;
+    size_t readPos = 0;
+    Packet out;
+};
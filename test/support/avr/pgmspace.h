@@ -0,0 +1,5 @@
+#pragma once
+
+// ArduinoJson includes this outside of Arduino when PROGMEM support is enabled
+
+#include "../pgmspace.h"
@@ -0,0 +1,137 @@
+#include <unity.h>
+
+#include <string>
+
+#include "CaptiveDns.h"
+
+namespace
+{
+    const IPAddress apIp(4, 3, 2, 1);
+
+    ///@brief Query with one question for name
+    WiFiUDP::Packet makeQuery(uint16_t id, const char* name, uint16_t type, bool edns = false)
+    {
+        WiFiUDP::Packet p = {(uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, (uint8_t)(edns ? 1 : 0)};
+        const std::string n = name;
+        size_t start = 0;
+        while (start < n.size())
+        {
+            size_t end = n.find('.', start);
+            if (end == std::string::npos)
+            {
+                end = n.size();
+            }
+            p.push_back(end - start);
+            p.insert(p.end(), n.begin() + start, n.begin() + end);
+            start = end + 1;
+        }
+        p.insert(p.end(), {0, (uint8_t)(type >> 8), (uint8_t)type, 0, 1});
+        if (edns)
+        {
+            // OPT record with a 4096 byte payload size
+            p.insert(p.end(), {0, 0, 41, 0x10, 0, 0, 0, 0, 0, 0, 0});
+        }
+        return p;
+    }
+
+    uint16_t readBe16(const WiFiUDP::Packet& p, size_t pos)
+    {
+        return ((uint16_t)p[pos] << 8) | p[pos + 1];
+    }
+
+    void checkAnswer(const WiFiUDP::Packet& response, uint16_t id, bool hasAnswer)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL(12, response.size());
+        TEST_ASSERT_EQUAL_HEX32(id, readBe16(response, 0));
+        // Response, authoritative, recursion desired, no error
+        TEST_ASSERT_EQUAL_HEX8(0x85, response[2]);
+        TEST_ASSERT_EQUAL_HEX8(0x00, response[3]);
+        TEST_ASSERT_EQUAL(1, readBe16(response, 4));
+        TEST_ASSERT_EQUAL(hasAnswer ? 1 : 0, readBe16(response, 6));
+        TEST_ASSERT_EQUAL(0, readBe16(response, 10));
+        if (hasAnswer)
+        {
+            const uint8_t* ip = response.data() + response.size() - 4;
+            TEST_ASSERT_EQUAL_UINT8(apIp[0], ip[0]);
+            TEST_ASSERT_EQUAL_UINT8(apIp[1], ip[1]);
+            TEST_ASSERT_EQUAL_UINT8(apIp[2], ip[2]);
+            TEST_ASSERT_EQUAL_UINT8(apIp[3], ip[3]);
+        }
+    }
+} // namespace
+
+void setUp()
+{
+    WiFiUDP::received().clear();
+    WiFiUDP::sent().clear();
+}
+
+void tearDown() { }
+
+void test_burst_is_answered_within_passes()
+{
+    CaptiveDns dns;
+    TEST_ASSERT_TRUE(dns.start(apIp));
+    // Phones send a burst of queries for the connectivity check domains
+    const char* const names[] = {"connectivitycheck.gstatic.com", "www.google.com", "captive.apple.com",
+        "clients3.google.com", "www.msftconnecttest.com", "detectportal.firefox.com", "time.android.com",
+        "mtalk.google.com", "www.apple.com", "dns.msftncsi.com", "play.googleapis.com", "android.clients.google.com"};
+    constexpr uint8_t numQueries = sizeof(names) / sizeof(names[0]);
+    for (uint8_t i = 0; i < numQueries; ++i)
+    {
+        WiFiUDP::received().push_back(makeQuery(0x1000 + i, names[i], 1));
+    }
+    // Four queries per loop pass
+    for (uint8_t pass = 1; pass <= numQueries / 4; ++pass)
+    {
+        dns.process();
+        TEST_ASSERT_EQUAL(pass * 4, WiFiUDP::sent().size());
+    }
+    TEST_ASSERT_TRUE(WiFiUDP::received().empty());
+    for (uint8_t i = 0; i < numQueries; ++i)
+    {
+        checkAnswer(WiFiUDP::sent()[i], 0x1000 + i, true);
+    }
+}
+
+void test_mixed_burst()
+{
+    CaptiveDns dns;
+    TEST_ASSERT_TRUE(dns.start(apIp));
+    WiFiUDP::received().push_back(makeQuery(1, "captive.apple.com", 1));
+    // AAAA gets an empty answer
+    WiFiUDP::received().push_back(makeQuery(2, "captive.apple.com", 28));
+    // Too short to be a query, ignored without an answer
+    WiFiUDP::received().push_back({0x12, 0x34, 0x01});
+    WiFiUDP::received().push_back(makeQuery(3, "connectivitycheck.gstatic.com", 1, true));
+    WiFiUDP::received().push_back(makeQuery(4, "www.google.com", 255));
+    dns.process();
+    dns.process();
+    TEST_ASSERT_TRUE(WiFiUDP::received().empty());
+    TEST_ASSERT_EQUAL(4, WiFiUDP::sent().size());
+    checkAnswer(WiFiUDP::sent()[0], 1, true);
+    checkAnswer(WiFiUDP::sent()[1], 2, false);
+    // The OPT record is dropped from the answer
+    checkAnswer(WiFiUDP::sent()[2], 3, true);
+    TEST_ASSERT_EQUAL(makeQuery(3, "connectivitycheck.gstatic.com", 1).size() + 16, WiFiUDP::sent()[2].size());
+    checkAnswer(WiFiUDP::sent()[3], 4, true);
+}
+
+void test_stopped_server_does_not_answer()
+{
+    CaptiveDns dns;
+    TEST_ASSERT_TRUE(dns.start(apIp));
+    dns.stop();
+    WiFiUDP::received().push_back(makeQuery(1, "captive.apple.com", 1));
+    dns.process();
+    TEST_ASSERT_TRUE(WiFiUDP::sent().empty());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_burst_is_answered_within_passes);
+    RUN_TEST(test_mixed_burst);
+    RUN_TEST(test_stopped_server_does_not_answer);
+    return UNITY_END();
+}
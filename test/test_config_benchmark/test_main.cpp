@@ -0,0 +1,179 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+
+#include <string>
+
+#include "ConfigFields.h"
+#include "ConfigSchema.h"
+
+namespace
+{
+    constexpr uint16_t rounds = 2000;
+
+    const char configJson[] = "{\"wifi\":{\"client_enabled\":true,\"client_dhcp_enabled\":false,"
+                              "\"client_ssid\":\"Home\",\"client_password\":\"correct horse battery staple\","
+                              "\"client_ip\":\"192.168.1.50\",\"client_gateway\":\"192.168.1.1\","
+                              "\"client_dns\":\"192.168.1.1\",\"client_mask\":\"255.255.255.0\",\"ap_enabled\":true,"
+                              "\"ap_ssid\":\"LedTree\",\"ap_password\":\"christmas\",\"wifi_enabled\":true},"
+                              "\"mqtt\":{\"enabled\":true,\"server\":\"broker.local\",\"port\":1883,"
+                              "\"id\":\"LedChristmasTree\",\"user\":\"tree\",\"password\":\"secret\"}}";
+
+    class StringStream : public Stream
+    {
+    public:
+        explicit StringStream(const char* data) : data(data) { }
+
+        int available() override { return data[pos] != '\0' ? 1 : 0; }
+        int read() override { return data[pos] != '\0' ? (uint8_t)data[pos++] : -1; }
+        int peek() override { return data[pos] != '\0' ? (uint8_t)data[pos] : -1; }
+        size_t write(uint8_t c) override
+        {
+            text += (char)c;
+            return 1;
+        }
+        using Print::write;
+
+        std::string text;
+
+    private:
+        const char* data;
+        size_t pos = 0;
+    };
+
+    std::string ipString(uint32_t ip)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (unsigned)(ip & 0xFF), (unsigned)((ip >> 8) & 0xFF),
+            (unsigned)((ip >> 16) & 0xFF), (unsigned)(ip >> 24));
+        return text;
+    }
+
+    void parseSchema(NetworkConfig& network, MqttConfig& mqtt)
+    {
+        ConfigSection sections[] = {{"wifi", networkFields, network}, {"mqtt", mqttFields, mqtt}};
+        StringStream in(configJson);
+        TEST_ASSERT_TRUE(ConfigSchema::parse(in, sections, 2));
+    }
+
+    void parseDocument(NetworkConfig& network, MqttConfig& mqtt)
+    {
+        StaticJsonDocument<1024> json;
+        TEST_ASSERT_FALSE(deserializeJson(json, configJson));
+        ConfigSection wifi {"wifi", networkFields, network};
+        ConfigSection mqttSection {"mqtt", mqttFields, mqtt};
+        wifi.tryUpdate(json["wifi"].as<JsonObjectConst>());
+        mqttSection.tryUpdate(json["mqtt"].as<JsonObjectConst>());
+    }
+
+    std::string writeSchema(NetworkConfig& network, MqttConfig& mqtt)
+    {
+        const ConfigSection sections[] = {{"wifi", networkFields, network}, {"mqtt", mqttFields, mqtt}};
+        StringStream out("");
+        ConfigSchema::write(out, sections, 2);
+        return out.text;
+    }
+
+    ///@brief Like the toJson functions of the config structs before the field tables
+    std::string writeDocument(const NetworkConfig& network, const MqttConfig& mqtt)
+    {
+        StaticJsonDocument<1024> json;
+        JsonObject wifi = json.createNestedObject("wifi");
+        wifi["client_enabled"] = network.clientEnabled;
+        wifi["client_dhcp_enabled"] = network.dhcpEnabled;
+        wifi["client_ssid"] = network.clientSsid;
+        wifi["client_password"] = network.clientPassword;
+        wifi["client_ip"] = ipString(network.clientIp);
+        wifi["client_gateway"] = ipString(network.clientGateway);
+        wifi["client_dns"] = ipString(network.clientDns);
+        wifi["client_mask"] = ipString(network.clientMask);
+        wifi["ap_enabled"] = network.apEnabled;
+        wifi["ap_ssid"] = network.apSsid;
+        wifi["ap_password"] = network.apPassword;
+        wifi["wifi_enabled"] = network.wifiEnabled;
+        JsonObject mqttObject = json.createNestedObject("mqtt");
+        mqttObject["enabled"] = mqtt.enabled;
+        mqttObject["server"] = mqtt.server;
+        mqttObject["port"] = mqtt.port;
+        mqttObject["id"] = mqtt.id;
+        mqttObject["user"] = mqtt.user;
+        mqttObject["password"] = mqtt.password;
+        std::string text;
+        serializeJson(json, text);
+        return text;
+    }
+
+    void report(const char* name, uint32_t schemaTime, uint32_t documentTime)
+    {
+        char message[128];
+        snprintf(message, sizeof(message), "%s: ConfigSchema %u ns, StaticJsonDocument<1024> %u ns", name,
+            (unsigned)((uint64_t)schemaTime * 1000 / rounds), (unsigned)((uint64_t)documentTime * 1000 / rounds));
+        TEST_MESSAGE(message);
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_paths_read_the_same()
+{
+    NetworkConfig schemaNetwork;
+    MqttConfig schemaMqtt;
+    parseSchema(schemaNetwork, schemaMqtt);
+    NetworkConfig documentNetwork;
+    MqttConfig documentMqtt;
+    parseDocument(documentNetwork, documentMqtt);
+    TEST_ASSERT_EQUAL_STRING(
+        writeSchema(documentNetwork, documentMqtt).c_str(), writeSchema(schemaNetwork, schemaMqtt).c_str());
+    TEST_ASSERT_TRUE(schemaNetwork.clientEnabled);
+    TEST_ASSERT_EQUAL_STRING("broker.local", schemaMqtt.server);
+}
+
+void test_parse_speed()
+{
+    // Only reported, the host is no measure for the controller
+    NetworkConfig network;
+    MqttConfig mqtt;
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < rounds; ++i)
+    {
+        parseSchema(network, mqtt);
+    }
+    const uint32_t schemaTime = micros() - start;
+    start = micros();
+    for (uint16_t i = 0; i < rounds; ++i)
+    {
+        parseDocument(network, mqtt);
+    }
+    report("Parse", schemaTime, micros() - start);
+}
+
+void test_write_speed()
+{
+    NetworkConfig network;
+    MqttConfig mqtt;
+    parseSchema(network, mqtt);
+    size_t length = 0;
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < rounds; ++i)
+    {
+        length += writeSchema(network, mqtt).size();
+    }
+    const uint32_t schemaTime = micros() - start;
+    start = micros();
+    for (uint16_t i = 0; i < rounds; ++i)
+    {
+        length += writeDocument(network, mqtt).size();
+    }
+    TEST_ASSERT_GREATER_THAN(0, length);
+    report("Write", schemaTime, micros() - start);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_paths_read_the_same);
+    RUN_TEST(test_parse_speed);
+    RUN_TEST(test_write_speed);
+    return UNITY_END();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// Created by make_fixture.py, do not edit
+
+#include <stdint.h>
+
+constexpr uint32_t baseSeed = 1;
+constexpr uint32_t baseSize = 65536;
+constexpr uint32_t newSize = 56336;
+
+const uint8_t patchData[] = {
+    0x54, 0x44, 0x50, 0x31, 0x10, 0xdc, 0x00, 0x00, 0x56, 0x52, 0x8d, 0x74, 0x2c, 0xc0, 0x8e, 0xc7,
+    0xa6, 0x65, 0x8a, 0x89, 0xdd, 0xc1, 0x40, 0x8b, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+    0x67, 0x2b, 0xb0, 0x5f, 0x6d, 0xc1, 0x96, 0x9c, 0xd5, 0x41, 0xb8, 0xe2, 0x9e, 0xe5, 0x1a, 0x04,
+    0x02, 0x10, 0x21, 0x01, 0xc5, 0x4f, 0xd1, 0xd0, 0x1a, 0xb2, 0x25, 0x74, 0xcb, 0x37, 0x8a, 0xae,
+    0xf5, 0xb1, 0x01, 0x10, 0xd8, 0x07, 0x02, 0xac, 0x02, 0x42, 0x02, 0x82, 0x06, 0x1a, 0x23, 0x59,
+    0xb6, 0x2a, 0x3b, 0xca, 0x3d, 0x09, 0x24, 0x3e, 0xfe, 0xbf, 0xff, 0x35, 0x9b, 0x88, 0xe8, 0x8a,
+    0x99, 0xe7, 0x64, 0x04, 0x35, 0x20, 0xd9, 0xc3, 0x77, 0xd1, 0x7b, 0x3d, 0x6a, 0x22, 0xa7, 0xe5,
+    0xdd, 0x54, 0x85, 0x15, 0xb6, 0x22, 0x03, 0x5c, 0x34, 0x4c, 0xf3, 0x9a, 0x70, 0x4c, 0xaa, 0xf7,
+    0x83, 0x60, 0x79, 0x91, 0xf9, 0xcd, 0x8f, 0x7c, 0xc2, 0x26, 0x30, 0x82, 0x56, 0x19, 0x8d, 0xe7,
+    0x73, 0xdc, 0x9e, 0x35, 0x3b, 0x5d, 0x9a, 0xd1, 0xd6, 0x0c, 0xa2, 0x43, 0xaa, 0xdd, 0x83, 0x53,
+    0x51, 0xef, 0x8e, 0x58, 0xb7, 0xff, 0xb2, 0x40, 0x42, 0x4d, 0x48, 0x3d, 0xc7, 0xbf, 0x2b, 0xed,
+    0x44, 0x81, 0x57, 0x0a, 0x90, 0xc7, 0x11, 0xad, 0x08, 0xf5, 0x27, 0xe4, 0x12, 0x99, 0x79, 0x72,
+    0xe3, 0x55, 0xd5, 0xe7, 0x9b, 0x15, 0x5c, 0x41, 0xe9, 0x63, 0x9f, 0x9d, 0xb0, 0x3a, 0x6b, 0xdd,
+    0x42, 0x7a, 0x79, 0x17, 0x9e, 0x2e, 0x36, 0xa6, 0xd2, 0x19, 0x08, 0xa8, 0x64, 0xf8, 0xa2, 0x17,
+    0xce, 0xfc, 0xae, 0xc5, 0x25, 0x39, 0x4c, 0x2e, 0x4d, 0x2d, 0x80, 0x8f, 0x38, 0xfe, 0x81, 0x07,
+    0x53, 0x36, 0x8a, 0x0b, 0x3e, 0x46, 0x18, 0xb2, 0x0a, 0x8b, 0xac, 0xcf, 0xe1, 0xaf, 0x8c, 0xc6,
+    0xe6, 0xe7, 0xd0, 0xb4, 0xb7, 0x85, 0x5b, 0xde, 0xf6, 0xb9, 0x92, 0x42, 0x73, 0x58, 0xe0, 0xba,
+    0x3b, 0x05, 0x4d, 0x17, 0x16, 0x5e, 0x4c, 0xc9, 0xa6, 0xae, 0x82, 0xfe, 0x58, 0x58, 0x10, 0x7f,
+    0x49, 0x74, 0x80, 0x5d, 0xf4, 0x29, 0x67, 0x83, 0x44, 0x4d, 0x27, 0x5b, 0x16, 0x77, 0xa0, 0x1e,
+    0xc2, 0x1f, 0x4c, 0x68, 0xd5, 0xd3, 0x40, 0xf5, 0x76, 0x2b, 0x1b, 0x09, 0x99, 0x00, 0xe1, 0xe9,
+    0xe0, 0x6e, 0x99, 0x90, 0xbb, 0x9c, 0xd3, 0x73, 0xee, 0xf6, 0x48, 0xd0, 0x1d, 0xd0, 0x77, 0x66,
+    0xe1, 0x05, 0xaa, 0x44, 0xe3, 0xe0, 0xe4, 0xc7, 0xfa, 0xe4, 0x7f, 0x5f, 0x21, 0xd1, 0x88, 0xd5,
+    0x3c, 0xdb, 0x27, 0x0e, 0x10, 0xde, 0x52, 0x59, 0x8b, 0x5f, 0x01, 0x3c, 0x1c, 0x93, 0xb8, 0xfb,
+    0x80, 0xe1, 0x23, 0x33, 0x65, 0x01, 0xe8, 0x07, 0xf4, 0x1c, 0x02, 0x01, 0xdd, 0x01, 0xdd, 0x24,
+    0x87, 0x27, 0x02, 0x01, 0x82, 0x01, 0xe5, 0x4b, 0x87, 0x27, 0x02, 0x01, 0x48, 0x01, 0xed, 0x72,
+    0x87, 0x27, 0x02, 0x01, 0x88, 0x01, 0xf5, 0x99, 0x01, 0x87, 0x27, 0x02, 0x01, 0x1d, 0x01, 0xfd,
+    0xc0, 0x01, 0x87, 0x27, 0x02, 0x01, 0x37, 0x01, 0x85, 0xe8, 0x01, 0xab, 0x02, 0x01, 0xc0, 0xb8,
+    0x02, 0xdc, 0x24, 0x02, 0x01, 0xe2, 0x01, 0x9d, 0xdd, 0x02, 0x87, 0x27, 0x02, 0x01, 0xbb, 0x01,
+    0xa5, 0x84, 0x03, 0x87, 0x27, 0x02, 0x01, 0xbd, 0x01, 0xad, 0xab, 0x03, 0x87, 0x27, 0x02, 0x01,
+    0xb5, 0x01, 0xb5, 0xd2, 0x03, 0x87, 0x27, 0x02, 0x01, 0x66, 0x01, 0xbd, 0xf9, 0x03, 0xc3, 0x06,
+    0x02, 0xf4, 0x03, 0x63, 0x03, 0x47, 0x49, 0xcb, 0xf3, 0x43, 0x04, 0x0f, 0x4f, 0x01, 0x0a, 0x83,
+    0x8a, 0xcb, 0x4f, 0xb7, 0xf7, 0xa4, 0x82, 0xbb, 0x51, 0x61, 0xd6, 0x15, 0x4d, 0xa1, 0xd1, 0xfb,
+    0xe7, 0x94, 0x63, 0xd0, 0x53, 0xdd, 0x9e, 0xd8, 0x45, 0x9b, 0xda, 0xa5, 0x9f, 0x56, 0x91, 0x95,
+    0xea, 0x19, 0x60, 0xe1, 0x76, 0xa1, 0xc3, 0x80, 0x7f, 0x43, 0x57, 0xb4, 0x2d, 0x42, 0x74, 0xa0,
+    0xa9, 0x7c, 0x05, 0x46, 0x80, 0x56, 0x1c, 0xf4, 0x41, 0x69, 0xe2, 0xcc, 0xfe, 0xe9, 0x3e, 0x6b,
+    0x57, 0x4e, 0x06, 0x89, 0xb6, 0x85, 0x6a, 0xd9, 0xcf, 0x54, 0x1e, 0xd6, 0xf5, 0x60, 0xea, 0x40,
+    0x7b, 0x80, 0x98, 0xd6, 0xa9, 0xad, 0x30, 0x03, 0x8b, 0xa5, 0x4e, 0x3a, 0x84, 0xe0, 0x31, 0xb7,
+    0x09, 0xc8, 0x05, 0x8c, 0x36, 0x95, 0x82, 0x81, 0x23, 0x25, 0x45, 0xff, 0x13, 0x7a, 0xdb, 0xc9,
+    0x8a, 0xdb, 0xc4, 0xb9, 0x1e, 0x5c, 0x9d, 0x52, 0x87, 0xbd, 0x49, 0x55, 0x97, 0x85, 0x0a, 0x92,
+    0x58, 0xed, 0xbc, 0xaf, 0xdd, 0xaa, 0x6e, 0x01, 0x5f, 0xf9, 0x93, 0x1c, 0x3f, 0x0d, 0xb1, 0xe6,
+    0xbb, 0x00, 0x14, 0x85, 0xa2, 0x2b, 0xc7, 0x5d, 0x4b, 0xc1, 0x61, 0xd1, 0xef, 0x9f, 0x28, 0x53,
+    0x80, 0xfd, 0xd2, 0x25, 0xe9, 0x51, 0x59, 0x8e, 0x75, 0xf5, 0xfd, 0x95, 0x29, 0xa5, 0xe7, 0x52,
+    0x74, 0xf9, 0xb9, 0x9e, 0xad, 0xb4, 0xa5, 0x8b, 0x58, 0xb8, 0xe8, 0x80, 0x99, 0xde, 0x3b, 0x32,
+    0x5e, 0x33, 0x16, 0xd6, 0xec, 0x36, 0x38, 0x5f, 0xd2, 0xd9, 0x39, 0x81, 0xf6, 0xf5, 0x19, 0x1a,
+    0x49, 0xd4, 0x67, 0xf5, 0x01, 0x60, 0x38, 0x40, 0x55, 0xb3, 0xea, 0xf6, 0x6a, 0xbe, 0x9e, 0x34,
+    0x9b, 0xcd, 0x34, 0x06, 0x4c, 0x2e, 0x0f, 0x2b, 0x1c, 0xe7, 0xeb, 0xe8, 0xaf, 0x6c, 0xdc, 0x27,
+    0xf5, 0x8e, 0xd2, 0x8f, 0x96, 0x76, 0xd7, 0x13, 0x05, 0x98, 0x5c, 0xb6, 0x9f, 0xa2, 0x3b, 0x06,
+    0xbb, 0xb5, 0x10, 0x33, 0xb9, 0x06, 0x03, 0xfb, 0xc5, 0xe8, 0xba, 0x8f, 0x70, 0x3e, 0x4f, 0x59,
+    0xae, 0xe3, 0x1b, 0xaf, 0x98, 0x1e, 0x12, 0x67, 0xe0, 0x84, 0x2e, 0x1e, 0xd9, 0x2d, 0x97, 0xd5,
+    0x97, 0x23, 0x4b, 0x40, 0x86, 0xce, 0x9f, 0xea, 0x5c, 0x7e, 0x77, 0x7f, 0x9e, 0xf9, 0x2e, 0x24,
+    0x1a, 0x34, 0x2c, 0xfb, 0x09, 0x71, 0x96, 0x38, 0x30, 0xed, 0xc9, 0xc5, 0x89, 0x1b, 0x41, 0x60,
+    0xe7, 0xb9, 0x6b, 0x5e, 0xdd, 0xd7, 0xb4, 0xb6, 0x9b, 0xa1, 0x3d, 0x32, 0xab, 0xcc, 0x86, 0x89,
+    0xc6, 0xc9, 0xd1, 0xde, 0x01, 0x73, 0xf6, 0x39, 0x03, 0x25, 0x10, 0x93, 0xf6, 0xb9, 0xc4, 0x67,
+    0x49, 0xf6, 0xae, 0xf2, 0xb9, 0x45, 0x78, 0x6a, 0xf2, 0xcb, 0x7c, 0x6a, 0x2f, 0x33, 0x75, 0xde,
+    0xe0, 0x16, 0xe2, 0x49, 0x9a, 0x38, 0xde, 0xf4, 0xe2, 0x0b, 0x4f, 0x3c, 0x65, 0xc9, 0x88, 0x51,
+    0x4e, 0x09, 0x01, 0x88, 0xa6, 0x05, 0x45, 0xa0, 0x6f, 0xb6, 0x75, 0x99, 0xd1, 0x62, 0x28, 0x2d,
+    0xcf, 0xdd, 0xb5, 0x06, 0xac, 0xeb, 0xdc, 0xd7, 0x6f, 0xe3, 0x7f, 0x29, 0xf8, 0xee, 0xb1, 0x7c,
+    0x91, 0x16, 0xaf, 0xa4, 0x6e, 0xe6, 0xf3, 0x18, 0x32, 0x67, 0xc2, 0x3e, 0x7d, 0x8c, 0xb5, 0x14,
+    0xa8, 0xe8, 0xb3, 0xf5, 0x6e, 0xc5, 0x61, 0x69, 0x49, 0xa2, 0x71, 0x0c, 0x20, 0xa8, 0x24, 0xf9,
+    0xa1, 0xfc, 0xb5, 0x0f, 0x40, 0x64, 0xce, 0x2e, 0x30, 0x31, 0x2d, 0x9f, 0x5e, 0x01, 0x24, 0xb3,
+    0xd4, 0xf8, 0x60, 0xca, 0x88, 0x6e, 0x01, 0x27, 0xad, 0x39, 0x89, 0xb0, 0xf9, 0x73, 0x20, 0x86,
+    0x7d, 0xd5, 0x3c, 0x95, 0x1a, 0xa6, 0x4f, 0x00,
+};
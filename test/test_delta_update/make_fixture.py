@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Create fixture.h with a patch from tools/delta_patch.py.
+
+The running image is 64 KiB from the Prng of the firmware with seed 1, so the test creates it without storing it.
+Run from the repository root after changing the patch format: python3 test/test_delta_update/make_fixture.py
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+BASE_SIZE = 65536
+
+
+def prng_bytes(seed, count):
+    """Low bytes of Prng::next, see src/Prng.h"""
+    state = seed
+    out = bytearray()
+    for _ in range(count):
+        state ^= (state << 13) & 0xFFFFFFFF
+        state ^= state >> 17
+        state ^= (state << 5) & 0xFFFFFFFF
+        out.append(state & 0xFF)
+    return bytes(out)
+
+
+def main():
+    old = prng_bytes(1, BASE_SIZE)
+    # Inserted code, a removed function, changed constants and appended data
+    new = bytearray(old[:1000] + prng_bytes(2, 300) + old[1000:30000] + old[40000:])
+    for offset in range(5000, len(new), 5000):
+        new[offset] ^= 0x55
+    new += prng_bytes(3, 500)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        paths = [os.path.join(tmp, name) for name in ("old.bin", "new.bin", "patch.bin")]
+        with open(paths[0], "wb") as f:
+            f.write(old)
+        with open(paths[1], "wb") as f:
+            f.write(new)
+        subprocess.run([sys.executable, os.path.join("tools", "delta_patch.py"), *paths], check=True)
+        with open(paths[2], "rb") as f:
+            patch = f.read()
+
+    lines = ["#pragma once", "", "// Created by make_fixture.py, do not edit", "", "#include <stdint.h>", "",
+             "constexpr uint32_t baseSeed = 1;", "constexpr uint32_t baseSize = %d;" % BASE_SIZE,
+             "constexpr uint32_t newSize = %d;" % len(new), "", "const uint8_t patchData[] = {"]
+    for i in range(0, len(patch), 16):
+        lines.append("    " + " ".join("0x%02x," % b for b in patch[i:i + 16]))
+    lines.append("};")
+    with open(os.path.join(os.path.dirname(__file__), "fixture.h"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,121 @@
+#include <Updater.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "DeltaPatch.h"
+#include "OtaUpdate.h"
+#include "Prng.h"
+#include "fixture.h"
+
+namespace
+{
+    constexpr size_t packetSize = 1460;
+    // Request line, headers and multipart header before the first byte of the file, closing boundary after it
+    constexpr size_t leadingFraming = 310;
+    constexpr size_t trailingFraming = 46;
+
+    std::vector<uint8_t> base;
+
+    ///@brief Upload the patch in TCP packets, with one loop pass after every packet
+    void upload(OtaUpdate& ota, AsyncClient& client)
+    {
+        ota.begin(sizeof(patchData) + leadingFraming + trailingFraming, nullptr, true, &client);
+        for (size_t pos = 0; pos < sizeof(patchData); pos += packetSize)
+        {
+            const size_t len = min(packetSize, sizeof(patchData) - pos);
+            const bool first = pos == 0;
+            const bool last = pos + len == sizeof(patchData);
+            const size_t framing = (first ? leadingFraming : 0) + (last ? trailingFraming : 0);
+            client.receive(len + framing, [&]() { ota.write(patchData + pos, len); });
+            ota.process();
+        }
+        ota.end();
+        for (uint16_t i = 0; i < 1000 && ota.getState() == OtaUpdate::State::receiving; ++i)
+        {
+            ota.process();
+        }
+    }
+} // namespace
+
+void setUp()
+{
+    Prng prng;
+    prng.seed(baseSeed);
+    base.resize(baseSize);
+    for (uint8_t& b : base)
+    {
+        b = (uint8_t)prng.next();
+    }
+    ESP.setSketch(base.data(), base.size());
+}
+
+void tearDown() { }
+
+void test_patch_completes_update()
+{
+    OtaUpdate ota;
+    AsyncClient client;
+    upload(ota, client);
+    TEST_ASSERT_EQUAL_STRING("", ota.getError());
+    TEST_ASSERT_TRUE(ota.getState() == OtaUpdate::State::success);
+    // The updater checked the md5 of the new image from the patch header
+    TEST_ASSERT_TRUE(Update.finished);
+    TEST_ASSERT_EQUAL(newSize, Update.image.size());
+}
+
+void test_framing_is_acknowledged()
+{
+    OtaUpdate ota;
+    AsyncClient client;
+    upload(ota, client);
+    TEST_ASSERT_EQUAL(0, client.unacked);
+    TEST_ASSERT_EQUAL(sizeof(patchData) + leadingFraming + trailingFraming, client.acked);
+}
+
+void test_wrong_base_fails_before_writing()
+{
+    base[100] ^= 0xFF;
+    OtaUpdate ota;
+    AsyncClient client;
+    upload(ota, client);
+    TEST_ASSERT_TRUE(ota.getState() == OtaUpdate::State::error);
+    TEST_ASSERT_EQUAL_STRING("Patch is for a different firmware", ota.getError());
+    TEST_ASSERT_EQUAL(0, Update.image.size());
+    TEST_ASSERT_EQUAL(0, client.unacked);
+}
+
+void test_base_is_hashed_in_chunks()
+{
+    DeltaPatch patch;
+    uint8_t out[256];
+    size_t consumed = 0;
+    size_t produced = 0;
+    size_t offset = 0;
+    uint16_t calls = 0;
+    while (produced == 0 && calls < 1000)
+    {
+        const DeltaPatch::Result result
+            = patch.decode(patchData + offset, sizeof(patchData) - offset, consumed, out, sizeof(out), produced);
+        TEST_ASSERT_TRUE(result == DeltaPatch::Result::ok);
+        offset += consumed;
+        ++calls;
+        if (produced == 0 && patch.hasHeader())
+        {
+            // Completion has to wait for the hash
+            TEST_ASSERT_FALSE(patch.needsInput());
+        }
+    }
+    // One call per 4 KB of the base, the output starts in the call which hashes the last chunk
+    TEST_ASSERT_GREATER_OR_EQUAL(baseSize / 4096, calls);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_patch_completes_update);
+    RUN_TEST(test_framing_is_acknowledged);
+    RUN_TEST(test_wrong_base_fails_before_writing);
+    RUN_TEST(test_base_is_hashed_in_chunks);
+    return UNITY_END();
+}
@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "TreeColors.h"
+#include "TreeEffects.h"
+#include "TreeLight.h"
+
+namespace
+{
+    constexpr uint8_t numFrames = 250;
+    constexpr uint8_t rounds = 20;
+
+    CRGB frames[numFrames * TreeLight::numLeds];
+
+    TreeColors makeColors()
+    {
+        TreeColors colors;
+        colors.seed(RANDOM_SEED);
+        colors.initRandomColors();
+        colors.finishMorph();
+        return colors;
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_frame_time()
+{
+    // Only reported, the host is no measure for the controller. The off effect is the cost of the dispatch itself.
+    const TreeColors colors = makeColors();
+    TEST_ASSERT_TRUE(TreeEffects::lockOffscreen());
+    for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue; ++i)
+    {
+        const EffectType type = (EffectType)i;
+        if (!TreeEffects::isEnabled(type))
+        {
+            continue;
+        }
+        const uint32_t start = micros();
+        for (uint8_t r = 0; r < rounds; ++r)
+        {
+            TreeEffects::renderOffscreen(type, colors, r * numFrames * TreeLight::frameInterval,
+                TreeLight::frameInterval, frames, numFrames);
+        }
+        const uint32_t time = micros() - start;
+        char message[80];
+        snprintf(message, sizeof(message), "%s: %u ns per frame",
+            reinterpret_cast<const char*>(TreeEffects::getName(type)),
+            (unsigned)((uint64_t)time * 1000 / (rounds * numFrames)));
+        TEST_MESSAGE(message);
+    }
+    TreeEffects::unlockOffscreen();
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_time);
+    return UNITY_END();
+}
@@ -0,0 +1,42 @@
+#include <unity.h>
+
+#include "TreeEffects.h"
+
+void setUp() { }
+void tearDown() { }
+
+void test_names_follow_registry()
+{
+    const char* const expected[] = {
+#define TREE_EFFECT_EXPECTED(type, Class, enabled) enabled ? #type : nullptr,
+        TREE_EFFECT_LIST(TREE_EFFECT_EXPECTED)
+#undef TREE_EFFECT_EXPECTED
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), (size_t)EffectType::maxValue);
+    for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue; ++i)
+    {
+        const char* name = reinterpret_cast<const char*>(TreeEffects::getName((EffectType)i));
+        if (expected[i] == nullptr)
+        {
+            TEST_ASSERT_NULL(name);
+        }
+        else
+        {
+            TEST_ASSERT_NOT_NULL(name);
+            TEST_ASSERT_EQUAL_STRING(expected[i], name);
+        }
+    }
+}
+
+void test_out_of_range_has_no_name()
+{
+    TEST_ASSERT_NULL(TreeEffects::getName(EffectType::maxValue));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_names_follow_registry);
+    RUN_TEST(test_out_of_range_has_no_name);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+#include <unity.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "TreeLight.h"
+
+namespace
+{
+    // Ten hashes of 100 frames each, 10 s at the frame interval
+    constexpr uint16_t framesPerHash = 100;
+    constexpr uint8_t hashesPerRun = 10;
+
+    struct SpeedName
+    {
+        Speed speed;
+        const char* name;
+    };
+    const SpeedName speeds[]
+        = {{Speed::stopped, "stopped"}, {Speed::slow, "slow"}, {Speed::medium, "medium"}, {Speed::fast, "fast"}};
+
+    Menu menu;
+    TreeLight light;
+
+    ///@brief FNV-1a, continues from hash
+    uint32_t hashBytes(uint32_t hash, const uint8_t* data, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    std::string goldenPath()
+    {
+        const std::string source = __FILE__;
+        return source.substr(0, source.find_last_of("/\\") + 1) + "golden.txt";
+    }
+
+    ///@brief Run every combination from a fixed start and return one line of hashes for each
+    std::string render()
+    {
+        std::ostringstream out;
+        for (uint8_t e = 0; e < (uint8_t)EffectType::maxValue; ++e)
+        {
+            const EffectType type = (EffectType)e;
+            if (!TreeEffects::isEnabled(type))
+            {
+                continue;
+            }
+            for (uint8_t selection = 0; selection < TreeColors::getSelectionCount(); ++selection)
+            {
+                if (!TreeColors::isSelectionEnabled(selection))
+                {
+                    continue;
+                }
+                for (const SpeedName& s : speeds)
+                {
+                    TreeColors& colors = light.getColors();
+                    colors.seed(RANDOM_SEED);
+                    colors.initRandomColors();
+                    colors.setSelection(selection);
+                    colors.finishMorph();
+                    light.setSpeed(s.speed);
+                    if (light.getEffectType() == type)
+                    {
+                        light.resetEffect(false);
+                    }
+                    else
+                    {
+                        light.setEffect(type);
+                    }
+                    out << reinterpret_cast<const char*>(TreeEffects::getName(type)) << ' '
+                        << TreeColors::getSelectionName(selection) << ' ' << s.name;
+                    for (uint8_t h = 0; h < hashesPerRun; ++h)
+                    {
+                        uint32_t hash = 2166136261u;
+                        for (uint16_t f = 0; f < framesPerHash; ++f)
+                        {
+                            HostClock::advance(TreeLight::frameInterval);
+                            light.update();
+                            hash = hashBytes(hash, FastLED.leds()->raw, TreeLight::numLeds * sizeof(CRGB));
+                        }
+                        char hex[10];
+                        snprintf(hex, sizeof(hex), " %08x", hash);
+                        out << hex;
+                    }
+                    out << '\n';
+                }
+            }
+        }
+        return out.str();
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_frames_match_golden()
+{
+    HostClock::manual = true;
+    light.init(menu);
+    // Sparkle is the transition which depends on the transition seed
+    light.setTransition(TransitionType::sparkle);
+    const std::string actual = render();
+
+    // Only recorded on request, a missing or stale file must not pass unnoticed
+    const char* record = getenv("GOLDEN_RECORD");
+    if (record != nullptr && strcmp(record, "1") == 0)
+    {
+        std::ofstream(goldenPath()) << actual;
+        TEST_IGNORE_MESSAGE("Recorded golden.txt from this run. Check and commit it.");
+    }
+    std::ifstream file(goldenPath());
+    if (!file)
+    {
+        TEST_FAIL_MESSAGE("No golden.txt, record it with GOLDEN_RECORD=1");
+    }
+    std::stringstream expectedStream;
+    expectedStream << file.rdbuf();
+    std::istringstream expectedLines(expectedStream.str());
+    std::istringstream actualLines(actual);
+    std::string expected;
+    std::string line;
+    while (std::getline(expectedLines, expected))
+    {
+        std::getline(actualLines, line);
+        // Effect, colors and speed of the first difference, frames from then on depend on it
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), line.c_str());
+    }
+    TEST_ASSERT_FALSE(std::getline(actualLines, line));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_match_golden);
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "TreeColors.h"
+#include "TreeEffects.h"
+#include "TreeLight.h"
+
+namespace
+{
+    constexpr uint8_t numFrames = 240;
+    constexpr uint8_t rounds = 20;
+
+    CRGB full[numFrames * TreeLight::numLeds];
+    CRGB keyframes[numFrames * TreeLight::numLeds];
+    CRGB interpolated[numFrames * TreeLight::numLeds];
+
+    struct Difference
+    {
+        uint8_t max = 0;
+        uint32_t sum = 0;
+        uint32_t count = 0;
+    };
+
+    TreeColors makeColors()
+    {
+        TreeColors colors;
+        colors.seed(RANDOM_SEED);
+        colors.initRandomColors();
+        colors.finishMorph();
+        return colors;
+    }
+
+    ///@brief Output of the tree with keyframes, like TreeLight::runKeyframes: one keyframe interval behind
+    void interpolate(uint8_t interval)
+    {
+        for (uint8_t n = 0; n < numFrames; ++n)
+        {
+            const uint8_t k = n / interval;
+            const CRGB* prev = keyframes + (k == 0 ? 0 : k - 1) * TreeLight::numLeds;
+            const CRGB* next = keyframes + k * TreeLight::numLeds;
+            const uint8_t amount = (uint16_t)(n % interval + 1) * 255 / interval;
+            for (uint8_t i = 0; i < TreeLight::numLeds; ++i)
+            {
+                interpolated[n * TreeLight::numLeds + i] = blend(prev[i], next[i], amount);
+            }
+        }
+    }
+
+    ///@brief Channel difference of the interpolated frames to the full rate frames lag frames earlier
+    Difference compare(uint8_t lag)
+    {
+        Difference d;
+        for (uint16_t n = lag; n < numFrames; ++n)
+        {
+            const uint8_t* a = interpolated[n * TreeLight::numLeds].raw;
+            const uint8_t* b = full[(n - lag) * TreeLight::numLeds].raw;
+            for (uint8_t c = 0; c < TreeLight::numLeds * 3; ++c)
+            {
+                const uint8_t diff = abs(a[c] - b[c]);
+                d.max = max(d.max, diff);
+                d.sum += diff;
+                ++d.count;
+            }
+        }
+        return d;
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_keyframes()
+{
+    // Only reported, the host is no measure for the controller
+    const TreeColors colors = makeColors();
+    TEST_ASSERT_TRUE(TreeEffects::lockOffscreen());
+    for (uint8_t e = 0; e < (uint8_t)EffectType::maxValue; ++e)
+    {
+        const EffectType type = (EffectType)e;
+        const uint8_t interval = TreeEffects::getKeyframeInterval(type);
+        if (!TreeEffects::isEnabled(type) || interval <= 1)
+        {
+            continue;
+        }
+        const uint8_t numKeyframes = (numFrames + interval - 1) / interval;
+        uint32_t start = micros();
+        for (uint8_t r = 0; r < rounds; ++r)
+        {
+            TreeEffects::renderOffscreen(type, colors, 0, TreeLight::frameInterval, full, numFrames);
+        }
+        const uint32_t fullTime = micros() - start;
+        start = micros();
+        for (uint8_t r = 0; r < rounds; ++r)
+        {
+            TreeEffects::renderOffscreen(
+                type, colors, 0, TreeLight::frameInterval * interval, keyframes, numKeyframes);
+            interpolate(interval);
+        }
+        const uint32_t keyframeTime = micros() - start;
+
+        // CPU time per second of the effect at the frame rate
+        const uint32_t framesPerSecond = 1000 / TreeLight::frameInterval;
+        const int32_t freed = (int32_t)((int64_t)((int32_t)fullTime - (int32_t)keyframeTime) * framesPerSecond
+            / (rounds * numFrames));
+        const Difference now = compare(0);
+        const Difference lagged = compare(interval - 1);
+        char message[200];
+        snprintf(message, sizeof(message),
+            "%s, every %u frames: %u ns per frame at full rate, %u ns with keyframes, %d us per second freed",
+            reinterpret_cast<const char*>(TreeEffects::getName(type)), interval,
+            (unsigned)((uint64_t)fullTime * 1000 / (rounds * numFrames)),
+            (unsigned)((uint64_t)keyframeTime * 1000 / (rounds * numFrames)), (int)freed);
+        TEST_MESSAGE(message);
+        snprintf(message, sizeof(message),
+            "%s: channel difference to the full rate max %u mean %.2f, to the full rate %lu ms earlier max %u mean "
+            "%.2f",
+            reinterpret_cast<const char*>(TreeEffects::getName(type)), now.max, (double)now.sum / now.count,
+            (interval - 1) * TreeLight::frameInterval, lagged.max, (double)lagged.sum / lagged.count);
+        TEST_MESSAGE(message);
+    }
+    TreeEffects::unlockOffscreen();
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_keyframes);
+    return UNITY_END();
+}
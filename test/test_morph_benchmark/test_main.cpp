@@ -0,0 +1,94 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+
+#include "TreeColors.h"
+
+namespace
+{
+    // A morph has to end within this many frames, 10 s at 100 frames per second
+    constexpr uint16_t maxFrames = 1000;
+    // Every morph is timed this often, the fastest run of each frame hides interruptions of the host
+    constexpr uint8_t rounds = 20;
+
+    uint32_t frameTimes[maxFrames];
+
+    uint32_t nanosSince(std::chrono::steady_clock::time_point start)
+    {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_morph_cost()
+{
+    // Only reported, the host is no measure for the controller
+    uint32_t maxSelect = 0;
+    uint32_t maxMorph = 0;
+    uint64_t totalMorph = 0;
+    uint32_t morphCalls = 0;
+    uint16_t maxMorphFrames = 0;
+    for (uint8_t from = 0; from < TreeColors::getSelectionCount(); ++from)
+    {
+        for (uint8_t to = 0; to < TreeColors::getSelectionCount(); ++to)
+        {
+            if (from == to || !TreeColors::isSelectionEnabled(from) || !TreeColors::isSelectionEnabled(to))
+            {
+                continue;
+            }
+            TreeColors start;
+            start.seed(RANDOM_SEED);
+            start.initRandomColors();
+            start.setSelection(from);
+            start.finishMorph();
+            uint16_t frames = 0;
+            uint32_t select = 0;
+            for (uint8_t r = 0; r < rounds; ++r)
+            {
+                TreeColors colors = start;
+                auto begin = std::chrono::steady_clock::now();
+                colors.setSelection(to);
+                const uint32_t selectTime = nanosSince(begin);
+                select = r == 0 ? selectTime : min(select, selectTime);
+                frames = 0;
+                bool morphing = true;
+                while (morphing)
+                {
+                    char message[48];
+                    snprintf(message, sizeof(message), "colors %u to %u", from, to);
+                    TEST_ASSERT_LESS_THAN_MESSAGE(maxFrames, frames, message);
+                    begin = std::chrono::steady_clock::now();
+                    morphing = colors.morph();
+                    const uint32_t time = nanosSince(begin);
+                    frameTimes[frames] = r == 0 ? time : min(frameTimes[frames], time);
+                    ++frames;
+                }
+            }
+            maxSelect = max(maxSelect, select);
+            for (uint16_t f = 0; f < frames; ++f)
+            {
+                maxMorph = max(maxMorph, frameTimes[f]);
+                totalMorph += frameTimes[f];
+            }
+            morphCalls += frames;
+            maxMorphFrames = max(maxMorphFrames, frames);
+        }
+    }
+    char message[160];
+    snprintf(message, sizeof(message),
+        "Fastest of %u runs: setSelection max %u ns, morph per frame max %u ns mean %u ns, longest morph %u frames",
+        rounds, (unsigned)maxSelect, (unsigned)maxMorph, (unsigned)(totalMorph / morphCalls), maxMorphFrames);
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_morph_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+
+#include "OutputLut.h"
+#include "TreeLight.h"
+
+namespace
+{
+    constexpr uint16_t numLeds = TreeLight::numLeds;
+    // Every step is timed this often, the fastest run hides interruptions of the host
+    constexpr uint16_t rounds = 200;
+
+    CRGB frame[numLeds];
+    CRGB calibration[numLeds];
+    uint16_t values[numLeds * 3];
+    uint8_t error[numLeds * 3];
+    CRGB output[numLeds];
+
+    uint32_t nanosSince(std::chrono::steady_clock::time_point start)
+    {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    void fillFrame()
+    {
+        for (uint8_t i = 0; i < numLeds; ++i)
+        {
+            frame[i] = CRGB(i * 19, 255 - i * 7, i * 3);
+            calibration[i] = CRGB(255, 240 - i, 224 + i);
+        }
+    }
+
+    ///@brief Fastest of @ref rounds runs of f in ns
+    template <typename F>
+    uint32_t fastest(F f)
+    {
+        uint32_t best = UINT32_MAX;
+        for (uint16_t r = 0; r < rounds; ++r)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            f();
+            best = min(best, nanosSince(begin));
+        }
+        return best;
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_dither_keeps_the_mean()
+{
+    // Every value of the fraction averages to the output value over one period of the pattern
+    constexpr uint8_t period = 1 << OutputLut::ditherBits;
+    for (uint16_t value = 0; value <= OutputLut::maxValue; value += 13)
+    {
+        uint16_t input[3] = {value, value, value};
+        uint8_t err[3] = {};
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < period; ++i)
+        {
+            CRGB out;
+            OutputLut::dither(input, err, &out, 1);
+            sum += out.r;
+        }
+        const uint32_t expected = ((uint32_t)value * period + 0x80) >> 8;
+        TEST_ASSERT_UINT32_WITHIN(1, expected, sum);
+    }
+}
+
+void test_frame_cost()
+{
+    // Only reported, the host is no measure for the controller
+    fillFrame();
+    OutputLut lut;
+    lut.setCorrection(CRGB(255, 176, 240));
+    lut.setBrightness(128);
+    lut.apply(frame, values, numLeds);
+    uint32_t sum = 0;
+    const uint32_t applyTime = fastest([&]() { sum += lut.apply(frame, values, numLeds); });
+    const uint32_t calibratedTime = fastest([&]() { sum += lut.apply(frame, values, numLeds, calibration); });
+    const uint32_t roundTime = fastest([&]() { OutputLut::round(values, output, numLeds); });
+    const uint32_t ditherTime = fastest([&]() { OutputLut::dither(values, error, output, numLeds); });
+    uint8_t brightness = 0;
+    const uint32_t brightnessTime = fastest(
+        [&]()
+        {
+            lut.setBrightness(++brightness);
+            sum += lut.apply(frame, values, numLeds);
+        });
+    TEST_ASSERT_GREATER_THAN(0, sum);
+
+    char message[200];
+    snprintf(message, sizeof(message),
+        "Fastest of %u runs for %u LEDs: apply %u ns, with calibration %u ns, after a brightness change %u ns, "
+        "round %u ns, dither %u ns",
+        rounds, numLeds, (unsigned)applyTime, (unsigned)calibratedTime, (unsigned)brightnessTime,
+        (unsigned)roundTime, (unsigned)ditherTime);
+    TEST_MESSAGE(message);
+    // Dithering refreshes between the frames as well
+    const uint32_t framesPerSecond = 1000 / TreeLight::frameInterval;
+    const uint32_t refreshesPerSecond = 1000 / TreeLight::ditherInterval;
+    snprintf(message, sizeof(message), "Per second: %u us rounded, %u us dithered without the LED output",
+        (unsigned)((applyTime + roundTime) * framesPerSecond / 1000),
+        (unsigned)((applyTime * framesPerSecond + ditherTime * refreshesPerSecond) / 1000));
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dither_keeps_the_mean);
+    RUN_TEST(test_frame_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "PixelKernels.h"
+
+namespace
+{
+    constexpr uint16_t numPixels = 256;
+
+    ///@brief Every channel value once per channel, in a different order for each channel
+    void fillPixels(CRGB* pixels, uint8_t offset)
+    {
+        for (uint16_t i = 0; i < numPixels; ++i)
+        {
+            pixels[i] = CRGB(i + offset, (i * 7) + offset, 255 - i - offset);
+        }
+    }
+
+    void assertSame(const CRGB* expected, const CRGB* actual, const char* message)
+    {
+        for (uint16_t i = 0; i < numPixels; ++i)
+        {
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected[i].r, actual[i].r, message);
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected[i].g, actual[i].g, message);
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected[i].b, actual[i].b, message);
+        }
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_nblend_is_exact()
+{
+    CRGB expected[numPixels];
+    CRGB actual[numPixels];
+    CRGB overlay[numPixels];
+    char message[48];
+    // Every pair of values and every amount
+    for (uint16_t shift = 0; shift < 256; ++shift)
+    {
+        fillPixels(overlay, shift);
+        for (uint16_t amount = 0; amount < 256; ++amount)
+        {
+            fillPixels(expected, 0);
+            fillPixels(actual, 0);
+            for (uint16_t i = 0; i < numPixels; ++i)
+            {
+                nblend(expected[i], overlay[i], amount);
+            }
+            PixelKernels::nblend(actual, overlay, numPixels, amount);
+            snprintf(message, sizeof(message), "shift %u, amount %u", shift, amount);
+            assertSame(expected, actual, message);
+        }
+    }
+}
+
+void test_blend_speed()
+{
+    // Only reported, the host is no measure for the controller
+    CRGB existing[numPixels];
+    CRGB overlay[numPixels];
+    fillPixels(existing, 0);
+    fillPixels(overlay, 128);
+    constexpr uint16_t rounds = 2000;
+    uint32_t start = micros();
+    for (uint16_t r = 0; r < rounds; ++r)
+    {
+        nblend(existing, overlay, numPixels, r & 0xFF);
+    }
+    const uint32_t fastledTime = micros() - start;
+    start = micros();
+    for (uint16_t r = 0; r < rounds; ++r)
+    {
+        PixelKernels::nblend(existing, overlay, numPixels, r & 0xFF);
+    }
+    const uint32_t kernelTime = micros() - start;
+    char message[96];
+    snprintf(message, sizeof(message), "nblend of %u pixels: FastLED %u ns, PixelKernels %u ns", numPixels,
+        (unsigned)((uint64_t)fastledTime * 1000 / rounds), (unsigned)((uint64_t)kernelTime * 1000 / rounds));
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_nblend_is_exact);
+    RUN_TEST(test_blend_speed);
+    return UNITY_END();
+}
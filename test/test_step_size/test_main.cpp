@@ -0,0 +1,73 @@
+#include <unity.h>
+
+#include "TreeColors.h"
+#include "TreeEffects.h"
+#include "TreeLight.h"
+
+namespace
+{
+    // 370 ms is a multiple of both steps
+    constexpr unsigned long fineStep = 10;
+    constexpr unsigned long coarseStep = 37;
+    // 133 s, more than two cycles of the cycling effect and eight colors of the gradients
+    constexpr uint16_t fineFrames = 13320;
+    constexpr uint16_t coarseFrames = fineFrames * fineStep / coarseStep + 1;
+
+    CRGB fine[fineFrames * TreeLight::numLeds];
+    CRGB coarse[coarseFrames * TreeLight::numLeds];
+
+    TreeColors makeColors(uint8_t selection)
+    {
+        TreeColors colors;
+        colors.seed(RANDOM_SEED);
+        colors.initRandomColors();
+        colors.setSelection(selection);
+        colors.finishMorph();
+        return colors;
+    }
+
+    void checkEffect(EffectType type, uint8_t selection)
+    {
+        const TreeColors colors = makeColors(selection);
+        TEST_ASSERT_TRUE(TreeEffects::lockOffscreen());
+        TreeEffects::renderOffscreen(type, colors, 0, fineStep, fine, fineFrames);
+        TreeEffects::renderOffscreen(type, colors, 0, coarseStep, coarse, coarseFrames);
+        TreeEffects::unlockOffscreen();
+        for (unsigned long time = 0; time / fineStep < fineFrames; time += fineStep * coarseStep)
+        {
+            const CRGB* a = fine + time / fineStep * TreeLight::numLeds;
+            const CRGB* b = coarse + time / coarseStep * TreeLight::numLeds;
+            char message[64];
+            snprintf(message, sizeof(message), "effect %u, colors %u, %lu ms", (unsigned)type, selection, time);
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(a, b, TreeLight::numLeds * sizeof(CRGB), message);
+        }
+    }
+} // namespace
+
+void setUp() { }
+void tearDown() { }
+
+void test_step_size_does_not_change_frames()
+{
+    for (uint8_t i = 0; i < (uint8_t)EffectType::maxValue; ++i)
+    {
+        if (!TreeEffects::isEnabled((EffectType)i))
+        {
+            continue;
+        }
+        for (uint8_t selection = 0; selection < TreeColors::getSelectionCount(); ++selection)
+        {
+            if (TreeColors::isSelectionEnabled(selection))
+            {
+                checkEffect((EffectType)i, selection);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_step_size_does_not_change_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Create a patch for a delta OTA update (/ota/delta).
+
+The patch turns the firmware running on the tree (old) into a new firmware image.
+See src/DeltaPatch.h for the format.
+
+Usage: delta_patch.py old.bin new.bin patch.bin
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"TDP1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+BLOCK_SIZE = 16
+# The flash mode and size in the image header are changed when flashing over serial
+DEFAULT_BASE_START = 16
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        b = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def make_ops(old, new, base_start, base_end):
+    # Index of all block offsets in the base range, first occurrence wins
+    index = {}
+    for offset in range(base_start, base_end - BLOCK_SIZE + 1):
+        index.setdefault(old[offset:offset + BLOCK_SIZE], offset)
+
+    ops = bytearray()
+    literal = bytearray()
+
+    def flush_literal():
+        if literal:
+            ops.append(OP_INSERT)
+            ops.extend(varint(len(literal)))
+            ops.extend(literal)
+            literal.clear()
+
+    pos = 0
+    # Always send the image header, it might differ from the flashed one
+    literal.extend(new[:base_start])
+    pos = min(base_start, len(new))
+    while pos < len(new):
+        offset = index.get(new[pos:pos + BLOCK_SIZE])
+        if offset is None:
+            literal.append(new[pos])
+            pos += 1
+            continue
+        length = BLOCK_SIZE
+        while pos + length < len(new) and offset + length < base_end and new[pos + length] == old[offset + length]:
+            length += 1
+        flush_literal()
+        ops.append(OP_COPY)
+        ops.extend(varint(offset))
+        ops.extend(varint(length))
+        pos += length
+    flush_literal()
+    ops.append(OP_END)
+    return bytes(ops)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("old", help="firmware running on the tree")
+    parser.add_argument("new", help="new firmware")
+    parser.add_argument("patch", help="output patch")
+    parser.add_argument("--base-start", type=int, default=DEFAULT_BASE_START,
+                        help="first byte of the old image which is used (default: %(default)s)")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    base_start = min(args.base_start, len(old))
+    base_end = len(old)
+    header = MAGIC + struct.pack("<I", len(new)) + hashlib.md5(new).digest()
+    header += struct.pack("<II", base_start, base_end) + hashlib.md5(old[base_start:base_end]).digest()
+    patch = header + make_ops(old, new, base_start, base_end)
+
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+    print("Patch: %d bytes, full image: %d bytes (%.1f%%)" % (len(patch), len(new), 100.0 * len(patch) / len(new)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
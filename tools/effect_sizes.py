@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Report the flash and RAM each optional effect and palette costs.
+
+Builds the firmware once with everything enabled and once with each build flag set to 0,
+then prints the difference reported by PlatformIO.
+
+Usage: effect_sizes.py [-e esp8266_d1_mini]
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+FLAGS = [
+    "EFFECT_TWO_COLOR_CHANGE",
+    "EFFECT_GRADIENT",
+    "EFFECT_RAINBOW",
+    "EFFECT_RUNNING_LIGHT",
+    "EFFECT_TWINKLEFOX",
+    "EFFECT_CYCLING",
+    "PALETTE_HOLLY",
+    "PALETTE_RETRO_C9",
+    "PALETTE_FAIRY_LIGHT",
+    "PALETTE_SNOW",
+]
+SIZE_RE = re.compile(r"^(RAM|Flash):.*\(used (\d+) bytes", re.MULTILINE)
+
+
+def build(env, flags):
+    environ = dict(os.environ)
+    environ["PLATFORMIO_BUILD_FLAGS"] = " ".join("-D%s=0" % flag for flag in flags)
+    result = subprocess.run(["pio", "run", "-e", env], env=environ, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        sys.stdout.write(result.stdout)
+        raise SystemExit("Build failed with %s" % (flags or "all enabled"))
+    sizes = dict((name, int(used)) for name, used in SIZE_RE.findall(result.stdout))
+    return sizes["Flash"], sizes["RAM"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-e", "--environment", default="esp8266_d1_mini", help="PlatformIO environment")
+    args = parser.parse_args()
+
+    flash, ram = build(args.environment, [])
+    print("%-24s %8s %8s" % ("", "flash", "ram"))
+    print("%-24s %8d %8d" % ("all enabled", flash, ram))
+    for flag in FLAGS:
+        flag_flash, flag_ram = build(args.environment, [flag])
+        print("%-24s %8d %8d" % (flag, flash - flag_flash, ram - flag_ram))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Integration test of the MQTT client against a local mosquitto broker.
+
+Enable MQTT on the tree with the address of the broker (mqtt.server in /api/config), then run this script on a
+machine which can reach the broker. It needs mosquitto_sub and mosquitto_pub (package mosquitto-clients).
+
+Checks the Home Assistant discovery, the availability topic, every command topic and the rate limit of state
+publishes. The tree is set back to its previous state at the end.
+
+Usage: mqtt_test.py [--broker localhost] [--port 1883] [--id LedChristmasTree]
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+import threading
+import time
+
+# State publishes are rate limited to twice per second
+MAX_STATE_RATE = 2
+DISCOVERY = {"light": "light", "color": "select", "speed": "select"}
+
+
+class Broker:
+    def __init__(self, host, port):
+        self.args = ["-h", host, "-p", str(port)]
+
+    def retained(self, topic, count, timeout=5):
+        """Messages already stored on the broker, as dict topic -> payload"""
+        out = subprocess.run(["mosquitto_sub", *self.args, "-v", "-t", topic, "-C", str(count), "-W", str(timeout)],
+                             capture_output=True, text=True)
+        messages = {}
+        for line in out.stdout.splitlines():
+            topic, _, payload = line.partition(" ")
+            messages[topic] = payload
+        return messages
+
+    def publish(self, topic, payload):
+        subprocess.run(["mosquitto_pub", *self.args, "-t", topic, "-m", payload], check=True)
+
+
+class Recorder:
+    """Records messages of a topic filter in the background"""
+
+    def __init__(self, broker, topic):
+        self.messages = []
+        self.lock = threading.Lock()
+        self.process = subprocess.Popen(["mosquitto_sub", *broker.args, "-v", "-R", "-t", topic],
+                                        stdout=subprocess.PIPE, text=True)
+        self.thread = threading.Thread(target=self._read, daemon=True)
+        self.thread.start()
+        # Wait for the subscription
+        time.sleep(0.5)
+
+    def _read(self):
+        for line in self.process.stdout:
+            topic, _, payload = line.rstrip("\n").partition(" ")
+            with self.lock:
+                self.messages.append((time.monotonic(), topic, payload))
+
+    def wait_for(self, topic, check, timeout=5):
+        """Wait for a message on topic for which check(payload) is true"""
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            with self.lock:
+                for _, t, payload in self.messages:
+                    if t == topic and check(payload):
+                        return payload
+            time.sleep(0.05)
+        return None
+
+    def clear(self):
+        with self.lock:
+            self.messages.clear()
+
+    def count(self, topic):
+        with self.lock:
+            return sum(1 for _, t, _ in self.messages if t == topic)
+
+    def stop(self):
+        self.process.terminate()
+
+
+def check(condition, message):
+    print(("ok   " if condition else "FAIL ") + message)
+    if not condition:
+        raise SystemExit(1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--broker", default="localhost", help="address of the broker (default: %(default)s)")
+    parser.add_argument("--port", type=int, default=1883, help="port of the broker (default: %(default)s)")
+    parser.add_argument("--id", default="LedChristmasTree", help="mqtt.id of the tree (default: %(default)s)")
+    args = parser.parse_args()
+    broker = Broker(args.broker, args.port)
+
+    # Discovery is retained, so it is there no matter when the tree connected
+    configs = broker.retained("homeassistant/+/+/config", len(DISCOVERY))
+    base = None
+    for component, kind in DISCOVERY.items():
+        found = [json.loads(p) for t, p in configs.items() if t.startswith("homeassistant/%s/" % kind)
+                 and t.endswith("_%s/config" % component)]
+        check(len(found) == 1, "discovery of %s" % component)
+        base = found[0]["~"]
+    check(base.startswith(args.id + "/"), "base topic %s" % base)
+    light_config = [json.loads(p) for t, p in configs.items() if t.startswith("homeassistant/light/")][0]
+    effects = light_config["fx_list"]
+    check(len(effects) > 0, "effect list %s" % effects)
+
+    status = broker.retained(base + "/status", 1)
+    check(status.get(base + "/status") == "online", "availability")
+
+    states = broker.retained(base + "/+/state", 3)
+    check(len(states) == 3, "retained state")
+    old_light = json.loads(states[base + "/light/state"])
+    old_color = states[base + "/color/state"]
+    old_speed = states[base + "/speed/state"]
+
+    recorder = Recorder(broker, base + "/+/state")
+    try:
+        broker.publish(base + "/light/set", '{"state":"OFF"}')
+        check(recorder.wait_for(base + "/light/state", lambda p: json.loads(p)["state"] == "OFF") is not None,
+              "turn off")
+
+        effect = effects[-1]
+        broker.publish(base + "/light/set", json.dumps({"state": "ON", "effect": effect, "brightness": 3}))
+        check(recorder.wait_for(base + "/light/state",
+                                lambda p: json.loads(p).get("effect") == effect and json.loads(p)["brightness"] == 3)
+              is not None, "turn on with effect %s" % effect)
+
+        colors = [json.loads(p) for t, p in configs.items() if t.endswith("_color/config")][0]["options"]
+        color = colors[-1] if colors[-1] != old_color else colors[0]
+        broker.publish(base + "/color/set", color)
+        check(recorder.wait_for(base + "/color/state", lambda p: p == color) is not None, "color %s" % color)
+
+        broker.publish(base + "/speed/set", "fast")
+        check(recorder.wait_for(base + "/speed/state", lambda p: p == "fast") is not None, "speed")
+
+        # Button spam, the state must only be published at the limited rate
+        time.sleep(1)
+        recorder.clear()
+        start = time.monotonic()
+        for i in range(20):
+            broker.publish(base + "/speed/set", "slow" if i % 2 else "medium")
+        duration = time.monotonic() - start + 1
+        time.sleep(1)
+        published = recorder.count(base + "/speed/state")
+        check(0 < published <= duration * MAX_STATE_RATE + 1,
+              "rate limit: %d publishes in %.1f s" % (published, duration))
+    finally:
+        recorder.stop()
+        broker.publish(base + "/color/set", old_color)
+        broker.publish(base + "/speed/set", old_speed)
+        broker.publish(base + "/light/set", json.dumps(old_light))
+    print("All checks passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())